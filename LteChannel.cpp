@@ -29,14 +29,24 @@
 #include "../phy/lte-phy.h"
 #include "../phy/multicast-destination-lte-phy.h"
 #include "../core/eventScheduler/simulator.h"
-#include "../componentManagers/FrameManager.h"
+#include "../componentManagers/frame-context.h"
+#include "../utility/event-profiler.h"
+#include "../utility/trace-sink.h"
 #include "../load-parameters.h"
 #include "propagation-model/propagation-loss-model.h"
+#include "propagation-model/channel-realization.h"
+#include "../utility/worker-pool.h"
+#include <algorithm>
 
 LteChannel::LteChannel()
 {
   m_attachedDevices = new vector<NetworkNode*> ();
+  m_nbUnicastDevices = 0;
   m_propagationLossModel = new PropagationLossModel ();
+  m_recipientIndex = false;
+  m_rxWorkers = nullptr;
+  m_lazyRealizations = false;
+  m_lazyRealizationModel = ChannelRealization::CHANNEL_MODEL_MACROCELL_URBAN;
 }
 
 LteChannel::~LteChannel()
@@ -44,14 +54,31 @@ LteChannel::~LteChannel()
   m_attachedDevices->clear ();
   delete m_attachedDevices;
   delete m_propagationLossModel;
+  delete m_rxWorkers;
 }
 
 void
 LteChannel::StartTx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src)
 {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
   cout << "LteChannel::StartTx ch " << GetChannelId () << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
+
+  if (m_recipientIndex)
+    {
+      // the recipients announced so far for src are those of this
+      // transmission; StartRx runs in the same order as StartTx
+      m_pendingRecipients.emplace_back ();
+      vector<NetworkNode*>& recipients = m_pendingRecipients.back ();
+      auto first = stable_partition (m_recipients.begin (), m_recipients.end (),
+                                     [src] (const pair<NetworkNode*, NetworkNode*>& r)
+                                     { return r.first != src; });
+      for (auto it = first; it != m_recipients.end (); it++)
+        {
+          recipients.push_back (it->second);
+        }
+      m_recipients.erase (first, m_recipients.end ());
+    }
 
   Simulator::Init()->Schedule(0.001,
                               &LteChannel::StartRx,
@@ -59,33 +86,59 @@ DEBUG_LOG_END
                               p,
                               txSignal,
                               src);
-DEBUG_LOG_START_1(LTE_SIM_TRANSMISSION_DEBUG)
+DEBUG_TRACE_START(DEBUG_TRANSMISSION)
   cout << "   =======  channel  =======" << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
 }
 
 void
 LteChannel::StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src)
 {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+  EventProfiler::Scope profile ("LteChannel::StartRx");
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
   cout << "LteChannel::StartRx ch " << GetChannelId () << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
+
+  const vector<NetworkNode*>& destinations = SelectDestinations ();
+  int nbDestinations = destinations.size ();
+  bool parallel = (m_rxWorkers != nullptr && m_propagationLossModel != nullptr);
+  if (parallel)
+    {
+      ComputeRxSignals (destinations, txSignal, src);
+    }
 
-  for (auto dst : *GetDevices())
+  for (int i = 0; i < nbDestinations; i++)
     {
+      NetworkNode* dst = destinations.at (i);
 
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
       cout << "\t Node " << dst->GetIDNetworkNode () << " is attached" << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
+
+      // destinations that would drop the signal get neither the propagation
+      // loss nor a copy of the burst
+      if (dst->GetNodeType() != NetworkNode::TYPE_MULTICAST_DESTINATION
+          && (parallel ? !m_rxNeeded [i] : !dst->GetPhy ()->IsRxNeeded (txSignal, src)))
+        {
+          continue;
+        }
 
       //APPLY THE PROPAGATION LOSS MODEL
       ReceivedSignal* rxSignal;
-      if (m_propagationLossModel != nullptr && dst->GetNodeType() != NetworkNode::TYPE_MULTICAST_DESTINATION )
+      if (parallel && dst->GetNodeType() != NetworkNode::TYPE_MULTICAST_DESTINATION)
         {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+          rxSignal = m_rxSignals [i];
+        }
+      else if (m_propagationLossModel != nullptr && dst->GetNodeType() != NetworkNode::TYPE_MULTICAST_DESTINATION )
+        {
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
           cout << "LteChannel::StartRx add propagation loss" << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
+          if (m_lazyRealizations)
+            {
+              GetChannelRealization (src, dst);
+            }
           rxSignal = GetPropagationLossModel ()->AddLossModel (src, dst, txSignal);
 
 //if(rxSignal->GetIsMBSFNSignal())cout << "MBSFN signal in lte-channel" << endl;
@@ -98,16 +151,18 @@ DEBUG_LOG_END
       //DELIVERY THE BURST OF PACKETS
       if(dst->GetNodeType() != NetworkNode::TYPE_MULTICAST_DESTINATION)
         {
+          // all destinations share p, a PHY copies it only to hand it to its device
           //dst->GetPhy ()->StartRx (p->Copy (), rxSignal);
-          dst->GetPhy ()->StartRx (p->Copy (), rxSignal, src);		// by zyb
+          dst->GetPhy ()->StartRx (p, rxSignal, src);		// by zyb
         }
       else
         {
           delete rxSignal;
           MulticastDestinationLtePhy* destPhy = (MulticastDestinationLtePhy*)dst->GetPhy();
-          if (FrameManager::Init()->MbsfnEnabled()==true)
+          const FrameContext& frame = FrameContext::Get ();
+          if (frame.m_mbsfnEnabled==true)
             {
-              if (FrameManager::Init()->isMbsfnSubframe()==true)
+              if (frame.m_mbsfnSubframe==true)
                 {
                   //destPhy->CreateCqiFeedbacks();
                 }
@@ -125,66 +180,229 @@ DEBUG_LOG_END
 
 }
 
+/*
+ * The devices StartRx visits: every attached device, or with the
+ * recipient index the recipients of the oldest transmission in flight and
+ * the multicast destinations, gathered in m_destinations.
+ */
+const vector<NetworkNode*>&
+LteChannel::SelectDestinations (void)
+{
+  vector<NetworkNode*>* devices = GetDevices ();
+  if (!m_recipientIndex)
+    {
+      return *devices;
+    }
+
+  vector<NetworkNode*> recipients;
+  recipients.swap (m_pendingRecipients.front ());
+  m_pendingRecipients.pop_front ();
+  if (FrameContext::Get ().m_mbsfn)
+    {
+      return *devices;
+    }
+
+  // attach order, as without the index; UEs detached since their
+  // allocation and UEs announced twice are skipped
+  m_recipientSlots.clear ();
+  for (auto d : recipients)
+    {
+      auto it = m_deviceSlots.find (d->GetIDNetworkNode ());
+      if (it != m_deviceSlots.end () && it->second < m_nbUnicastDevices)
+        {
+          m_recipientSlots.push_back (it->second);
+        }
+    }
+  sort (m_recipientSlots.begin (), m_recipientSlots.end ());
+  m_recipientSlots.erase (unique (m_recipientSlots.begin (), m_recipientSlots.end ()),
+                          m_recipientSlots.end ());
+
+  m_destinations.clear ();
+  for (int slot : m_recipientSlots)
+    {
+      m_destinations.push_back (devices->at (slot));
+    }
+  m_destinations.insert (m_destinations.end (),
+                         devices->begin () + m_nbUnicastDevices, devices->end ());
+  return m_destinations;
+}
+
+/*
+ * Parallel reception, before any delivery: IsRxNeeded and the realization
+ * refresh (the only step drawing random numbers or writing shared state)
+ * run serially in attach order, then the workers compute AddLossModel for
+ * the destinations that need the signal. Each job writes its own slot of
+ * m_rxSignals only.
+ */
+void
+LteChannel::ComputeRxSignals (const vector<NetworkNode*>& destinations,
+                              TransmittedSignal* txSignal, NetworkNode* src)
+{
+  int nbDestinations = destinations.size ();
+  m_rxNeeded.assign (nbDestinations, false);
+  m_rxSignals.assign (nbDestinations, nullptr);
+  for (int i = 0; i < nbDestinations; i++)
+    {
+      NetworkNode* dst = destinations.at (i);
+      if (dst->GetNodeType () == NetworkNode::TYPE_MULTICAST_DESTINATION
+          || !dst->GetPhy ()->IsRxNeeded (txSignal, src))
+        {
+          continue;
+        }
+      m_rxNeeded [i] = true;
+      ChannelRealization* c = GetChannelRealization (src, dst);
+      if (c != nullptr && c->NeedForUpdate ())
+        {
+          c->UpdateModels ();
+        }
+    }
+
+  m_rxWorkers->ParallelFor (nbDestinations, [&] (int i)
+    {
+      if (m_rxNeeded [i])
+        {
+          m_rxSignals [i] = m_propagationLossModel->AddLossModel (src, destinations [i], txSignal);
+        }
+    });
+}
+
+void
+LteChannel::SetRxWorkers (int nbWorkers)
+{
+  delete m_rxWorkers;
+  m_rxWorkers = (nbWorkers > 0) ? new WorkerPool (nbWorkers) : nullptr;
+}
+
+int
+LteChannel::GetRxWorkers (void)
+{
+  return (m_rxWorkers != nullptr) ? m_rxWorkers->GetNbWorkers () : 0;
+}
+
+void
+LteChannel::SetLazyRealizations (ChannelRealization::ChannelModel model)
+{
+  m_lazyRealizations = true;
+  m_lazyRealizationModel = model;
+}
+
+bool
+LteChannel::GetLazyRealizations (void)
+{
+  return m_lazyRealizations;
+}
+
+ChannelRealization*
+LteChannel::GetChannelRealization (NetworkNode* src, NetworkNode* dst)
+{
+  ChannelRealization* c = m_propagationLossModel->GetChannelRealization (src, dst);
+  if (c == nullptr && m_lazyRealizations)
+    {
+      c = new ChannelRealization (src, dst, m_lazyRealizationModel);
+      m_propagationLossModel->AddChannelRealization (c);
+    }
+  return c;
+}
+
+void
+LteChannel::SetRecipientIndex (bool b)
+{
+  m_recipientIndex = b;
+}
+
+bool
+LteChannel::GetRecipientIndex (void)
+{
+  return m_recipientIndex;
+}
+
+void
+LteChannel::AddRecipient (NetworkNode* src, NetworkNode* d)
+{
+  if (m_recipientIndex)
+    {
+      m_recipients.push_back (make_pair (src, d));
+    }
+}
+
 void
 LteChannel::AddDevice (NetworkNode* d)
 {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
   cout << "LteChannel " << m_channelId << " ADD Node " << d->GetIDNetworkNode ()<< endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
+
+  if (IsAttached (d))
+    {
+      return;
+    }
 
-  vector<NetworkNode*>::iterator it, ins_pos;
-  ins_pos = m_attachedDevices->end();
-  if (m_attachedDevices->size()>0)
+  m_attachedDevices->push_back (d);
+  int slot = m_attachedDevices->size () - 1;
+  // UEs shoul be inserted before multicast destinations: the first
+  // multicast destination moves to the end to make room
+  if (d->GetNodeType () != NetworkNode::TYPE_MULTICAST_DESTINATION)
     {
-      for (it=m_attachedDevices->end()-1; it>=m_attachedDevices->begin(); it--)
+      if (slot != m_nbUnicastDevices)
         {
-          // UEs shoul be inserted before multicast destinations
-          if ( (*it)->GetNodeType()==NetworkNode::TYPE_MULTICAST_DESTINATION )
-            {
-              ins_pos = it;
-            }
-          else
-            {
-              break;
-            }
+          MoveDevice (m_nbUnicastDevices, slot);
+          slot = m_nbUnicastDevices;
+          m_attachedDevices->at (slot) = d;
         }
+      m_nbUnicastDevices++;
     }
-  m_attachedDevices->insert(ins_pos,d);
+  m_deviceSlots [d->GetIDNetworkNode ()] = slot;
 }
 
 void
 LteChannel::DelDevice (NetworkNode* d)
 {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
   cout << "LteChannel " << m_channelId << " DEL Node " << d->GetIDNetworkNode ()<< endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
-  vector<NetworkNode*> *new_list = new vector<NetworkNode*> ();
-  for (auto node : *GetDevices ())
+  auto it = m_deviceSlots.find (d->GetIDNetworkNode ());
+  if (it == m_deviceSlots.end ())
     {
-      if (node->GetIDNetworkNode () != d->GetIDNetworkNode ())
-        {
-          new_list->push_back (node);
-        }
+      return;
     }
+  int slot = it->second;
+  m_deviceSlots.erase (it);
 
-  m_attachedDevices->clear ();
-  delete m_attachedDevices;
-  m_attachedDevices = new_list;
+  // the last device of the same partition takes the free slot, then the
+  // last multicast destination fills the hole left in the UE partition
+  int last = m_attachedDevices->size () - 1;
+  if (slot < m_nbUnicastDevices)
+    {
+      m_nbUnicastDevices--;
+      MoveDevice (m_nbUnicastDevices, slot);
+      slot = m_nbUnicastDevices;
+    }
+  MoveDevice (last, slot);
+  m_attachedDevices->pop_back ();
+}
+
+void
+LteChannel::MoveDevice (int from, int to)
+{
+  if (from == to)
+    {
+      return;
+    }
+  NetworkNode* node = m_attachedDevices->at (from);
+  m_attachedDevices->at (to) = node;
+  m_deviceSlots [node->GetIDNetworkNode ()] = to;
 }
 
 bool
 LteChannel::IsAttached (NetworkNode* d)
 {
-  for (auto node : *GetDevices ())
+  if (m_deviceSlots.count (d->GetIDNetworkNode ()) > 0)
     {
-      if (node->GetIDNetworkNode () == d->GetIDNetworkNode ())
-        {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
-          cout << "LteChannel find Node " << d->GetIDNetworkNode ()<< endl;
-DEBUG_LOG_END
-          return true;
-        }
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
+      cout << "LteChannel find Node " << d->GetIDNetworkNode ()<< endl;
+DEBUG_TRACE_END
+      return true;
     }
   return false;
 }
@@ -0,0 +1,134 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author: Giuseppe Piro <g.piro@poliba.it>
+ */
+
+
+#ifndef LTECHANNEL_H_
+#define LTECHANNEL_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include "../load-parameters.h"
+#include "propagation-model/channel-realization.h"
+
+class NetworkNode;
+class PacketBurst;
+class TransmittedSignal;
+class PropagationLossModel;
+class WorkerPool;
+
+class LteChannel
+{
+public:
+  LteChannel();
+  virtual ~LteChannel();
+
+  void StartTx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src);
+  void StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src);
+
+  /*
+   * Attach and detach are O(1): devices are indexed by node ID, and a
+   * detached device is replaced by the last one of its partition (UEs
+   * first, then multicast destinations). The order seen by GetDevices
+   * only depends on the sequence of attach and detach calls.
+   */
+  void AddDevice (NetworkNode* d);
+  void DelDevice (NetworkNode* d);
+  bool IsAttached (NetworkNode* d);
+  vector<NetworkNode*>* GetDevices (void);
+
+  void SetPropagationLossModel (PropagationLossModel* m);
+  PropagationLossModel* GetPropagationLossModel (void);
+
+  void SetChannelId (int id);
+  int GetChannelId (void);
+
+  /*
+   * Recipient index for downlink channels, off by default and set before
+   * the simulation starts. A transmission then reaches only the UEs added with AddRecipient for
+   * its source since the source's previous transmission (the UEs of its
+   * allocation map), in attach order, and the multicast destinations.
+   * The other attached devices, eNBs included, are not visited at all:
+   * unscheduled UEs measure no CQI in that TTI. Transmissions in MBSFN
+   * subframes still reach every device.
+   */
+  void SetRecipientIndex (bool b);
+  bool GetRecipientIndex (void);
+  void AddRecipient (NetworkNode* src, NetworkNode* d);
+
+  /*
+   * Parallel reception, off by default (0). With nbWorkers >= 1, StartRx
+   * first checks IsRxNeeded for every destination and refreshes their
+   * channel realizations serially, in attach order; the propagation loss
+   * of all of them is then computed on nbWorkers threads, and the signals
+   * are delivered to the PHYs serially in attach order. The realizations
+   * draw their random numbers in the same order whatever nbWorkers is, so
+   * a seed gives the same run with 1 or n workers (not the same as with
+   * parallel reception off, where each refresh follows the previous PHY
+   * reception). AddLossModel must only read the realization once it is
+   * refreshed. The PHY reception (SINR, BLER) stays serial.
+   */
+  void SetRxWorkers (int nbWorkers);
+  int GetRxWorkers (void);
+
+  /*
+   * Channel realizations created on first use, off by default. Once a
+   * model is set, a (source, destination) pair that has no realization
+   * gets one of that model the first time the channel delivers a signal
+   * between them, so a scenario does not have to create one per UE up
+   * front. Needs a propagation loss model.
+   */
+  void SetLazyRealizations (ChannelRealization::ChannelModel model);
+  bool GetLazyRealizations (void);
+  // realization of (src, dst), created here in lazy mode
+  ChannelRealization* GetChannelRealization (NetworkNode* src, NetworkNode* dst);
+
+private:
+  void MoveDevice (int from, int to);
+  const vector<NetworkNode*>& SelectDestinations (void);
+  void ComputeRxSignals (const vector<NetworkNode*>& destinations,
+                         TransmittedSignal* txSignal, NetworkNode* src);
+
+  vector<NetworkNode*> *m_attachedDevices;
+  unordered_map<int, int> m_deviceSlots; // node ID -> index in m_attachedDevices
+  int m_nbUnicastDevices; // UEs and eNBs, stored before multicast destinations
+  int m_channelId;
+  PropagationLossModel* m_propagationLossModel;
+
+  bool m_recipientIndex;
+  // (source, UE) pairs announced for the next transmission of the source
+  vector< pair<NetworkNode*, NetworkNode*> > m_recipients;
+  // recipients of the transmissions in flight, oldest first
+  deque< vector<NetworkNode*> > m_pendingRecipients;
+  vector<int> m_recipientSlots;
+  vector<NetworkNode*> m_destinations; // of the reception in progress
+
+  WorkerPool* m_rxWorkers;
+  // per destination of the reception in progress, parallel reception only
+  vector<char> m_rxNeeded;
+  vector<TransmittedSignal*> m_rxSignals;
+
+  bool m_lazyRealizations;
+  ChannelRealization::ChannelModel m_lazyRealizationModel;
+};
+
+#endif /* LTECHANNEL_H_ */
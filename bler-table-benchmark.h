@@ -0,0 +1,116 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../phy/bler-table.h"
+#include "../phy/BLERTrace/BLERvsSINR_15CQI_AWGN.h"
+#include "../phy/BLERTrace/BLERvsSINR_15CQI_TU.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <math.h>
+
+/*
+ * Compares the BLER table with the BLERvsSINR trace walk used by
+ * WidebandCqiEesmErrorModel::CheckForPhysicalError.
+ * Usage: blerTable [decisions] [cacheFile]
+ * Same SINR, CQI and random draws are fed to both paths; prints the build
+ * (or load) time, ns per lookup, error decisions that differ and the
+ * largest BLER difference.
+ */
+static void blerTableBenchmark (int argc, char *argv[])
+{
+  int nbDecisions = 1000000;
+  if (argc > 2)
+    {
+      nbDecisions = atoi(argv[2]);
+    }
+
+  BlerTable* table = BlerTable::Init ();
+  auto start = chrono::steady_clock::now ();
+  if (argc > 3)
+    {
+      table->LoadOrBuild (argv[3]);
+    }
+  else
+    {
+      table->Build ();
+    }
+  auto stop = chrono::steady_clock::now ();
+  double buildMs = chrono::duration<double, milli> (stop - start).count ();
+
+  srand (1);
+  vector<double> sinr (nbDecisions);
+  vector<int> cqi (nbDecisions);
+  vector<double> randomNumber (nbDecisions);
+  for (int i = 0; i < nbDecisions; i++)
+    {
+      sinr.at (i) = -10 + 40. * rand () / RAND_MAX;
+      cqi.at (i) = BlerTable::MIN_CQI + rand () % (BlerTable::MAX_CQI - BlerTable::MIN_CQI + 1);
+      randomNumber.at (i) = (rand () % 100) / 100.;
+    }
+
+  for (int type = 0; type < BlerTable::NB_CHANNEL_TYPES; type++)
+    {
+      vector<bool> traceErrors (nbDecisions);
+      vector<double> traceBler (nbDecisions);
+      start = chrono::steady_clock::now ();
+      for (int i = 0; i < nbDecisions; i++)
+        {
+          if (type == BlerTable::CHANNEL_TYPE_TU)
+            {
+              traceBler.at (i) = GetBLER_TU (sinr.at (i), cqi.at (i));
+            }
+          else
+            {
+              traceBler.at (i) = GetBLER_AWGN (sinr.at (i), cqi.at (i));
+            }
+          traceErrors.at (i) = randomNumber.at (i) < traceBler.at (i);
+        }
+      stop = chrono::steady_clock::now ();
+      double traceNs = chrono::duration<double, nano> (stop - start).count () / nbDecisions;
+
+      int mismatches = 0;
+      int errors = 0;
+      double maxDiff = 0;
+      start = chrono::steady_clock::now ();
+      for (int i = 0; i < nbDecisions; i++)
+        {
+          double bler = table->GetBLER ((BlerTable::ChannelType) type, sinr.at (i), cqi.at (i));
+          bool error = randomNumber.at (i) < bler;
+          errors += error;
+          mismatches += (error != traceErrors.at (i));
+          maxDiff = max (maxDiff, fabs (bler - traceBler.at (i)));
+        }
+      stop = chrono::steady_clock::now ();
+      double tableNs = chrono::duration<double, nano> (stop - start).count () / nbDecisions;
+
+      cout << "BLER_TABLE " << (type == BlerTable::CHANNEL_TYPE_TU ? "TU" : "AWGN")
+           << " decisions " << nbDecisions
+           << " build_ms " << buildMs
+           << " trace_ns " << traceNs
+           << " table_ns " << tableNs
+           << " speedup " << traceNs / tableNs
+           << " errors " << errors
+           << " mismatches " << mismatches
+           << " max_bler_diff " << maxDiff << endl;
+    }
+}
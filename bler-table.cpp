@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "bler-table.h"
+#include "BLERTrace/BLERvsSINR_15CQI_AWGN.h"
+#include "BLERTrace/BLERvsSINR_15CQI_TU.h"
+#include <fstream>
+#include <cstring>
+#include <math.h>
+
+static const char tableMagic [8] = {'B', 'L', 'E', 'R', 'T', 'A', 'B', '1'};
+
+BlerTable* BlerTable::ptr = nullptr;
+
+BlerTable*
+BlerTable::Init (void)
+{
+  if (ptr == nullptr)
+    {
+      ptr = new BlerTable ();
+    }
+  return ptr;
+}
+
+BlerTable::BlerTable ()
+{
+  m_minSinr = 0;
+  m_step = 0;
+  m_nbPoints = 0;
+}
+
+double
+BlerTable::GetTraceBLER (ChannelType type, double sinr, int cqi)
+{
+  if (type == CHANNEL_TYPE_TU)
+    {
+      return GetBLER_TU (sinr, cqi);
+    }
+  return GetBLER_AWGN (sinr, cqi);
+}
+
+void
+BlerTable::Build (double minSinr, double maxSinr, double step)
+{
+  int nbCqi = MAX_CQI - MIN_CQI + 1;
+  m_minSinr = minSinr;
+  m_step = step;
+  m_nbPoints = (int) round ((maxSinr - minSinr) / step) + 1;
+  m_values.resize (NB_CHANNEL_TYPES * nbCqi * m_nbPoints);
+
+  for (int type = 0; type < NB_CHANNEL_TYPES; type++)
+    {
+      for (int cqi = MIN_CQI; cqi <= MAX_CQI; cqi++)
+        {
+          double* curve = m_values.data () + (type * nbCqi + cqi - MIN_CQI) * m_nbPoints;
+          for (int i = 0; i < m_nbPoints; i++)
+            {
+              curve [i] = GetTraceBLER ((ChannelType) type, m_minSinr + i * m_step, cqi);
+            }
+        }
+    }
+}
+
+bool
+BlerTable::Save (const char* fileName)
+{
+  ofstream out (fileName, ios::binary);
+  if (!out)
+    {
+      return false;
+    }
+  int nbCqi = MAX_CQI - MIN_CQI + 1;
+  int nbTypes = NB_CHANNEL_TYPES;
+  out.write (tableMagic, sizeof (tableMagic));
+  out.write ((const char*) &nbTypes, sizeof (nbTypes));
+  out.write ((const char*) &nbCqi, sizeof (nbCqi));
+  out.write ((const char*) &m_nbPoints, sizeof (m_nbPoints));
+  out.write ((const char*) &m_minSinr, sizeof (m_minSinr));
+  out.write ((const char*) &m_step, sizeof (m_step));
+  out.write ((const char*) m_values.data (), m_values.size () * sizeof (double));
+  return (bool) out;
+}
+
+bool
+BlerTable::Load (const char* fileName)
+{
+  ifstream in (fileName, ios::binary);
+  if (!in)
+    {
+      return false;
+    }
+  char magic [sizeof (tableMagic)];
+  int nbTypes, nbCqi, nbPoints;
+  double minSinr, step;
+  in.read (magic, sizeof (magic));
+  in.read ((char*) &nbTypes, sizeof (nbTypes));
+  in.read ((char*) &nbCqi, sizeof (nbCqi));
+  in.read ((char*) &nbPoints, sizeof (nbPoints));
+  in.read ((char*) &minSinr, sizeof (minSinr));
+  in.read ((char*) &step, sizeof (step));
+  // the header is checked before anything is allocated: a corrupt file
+  // must neither ask for a huge table nor give NaN grid positions
+  if (!in || memcmp (magic, tableMagic, sizeof (magic)) != 0
+      || nbTypes != NB_CHANNEL_TYPES || nbCqi != MAX_CQI - MIN_CQI + 1
+      || nbPoints < 2 || nbPoints > MAX_POINTS
+      || !isfinite (minSinr) || !isfinite (step) || !(step > 0)
+      || !isfinite (minSinr + (nbPoints - 1) * step))
+    {
+      return false;
+    }
+  size_t size = (size_t) nbTypes * nbCqi * nbPoints;
+  streampos start = in.tellg ();
+  in.seekg (0, ios::end);
+  if (!in || in.tellg () - start != (streamoff) (size * sizeof (double)))
+    {
+      return false;
+    }
+  in.seekg (start);
+
+  vector<double> values (size);
+  in.read ((char*) values.data (), values.size () * sizeof (double));
+  if (!in)
+    {
+      return false;
+    }
+  for (double v : values)
+    {
+      if (!(v >= 0 && v <= 1))
+        {
+          return false;
+        }
+    }
+  m_minSinr = minSinr;
+  m_step = step;
+  m_nbPoints = nbPoints;
+  m_values.swap (values);
+  return true;
+}
+
+void
+BlerTable::LoadOrBuild (const char* fileName)
+{
+  if (Load (fileName))
+    {
+      return;
+    }
+  Build ();
+  if (!Save (fileName))
+    {
+      cout << "BlerTable: unable to save the BLER table to " << fileName << endl;
+    }
+}
+
+bool
+BlerTable::IsReady (void)
+{
+  return m_nbPoints > 0;
+}
+
+double
+BlerTable::GetBLER (ChannelType type, double sinr, int cqi)
+{
+  double position = (sinr - m_minSinr) / m_step;
+  if (m_nbPoints == 0 || cqi < MIN_CQI || cqi > MAX_CQI
+      || !(position >= 0) || position > m_nbPoints - 1)
+    {
+      return GetTraceBLER (type, sinr, cqi);
+    }
+
+  int nbCqi = MAX_CQI - MIN_CQI + 1;
+  const double* curve = m_values.data () + (type * nbCqi + cqi - MIN_CQI) * m_nbPoints;
+  int i = (int) position;
+  if (i == m_nbPoints - 1)
+    {
+      return curve [i];
+    }
+  double w = position - i;
+  return curve [i] + w * (curve [i + 1] - curve [i]);
+}
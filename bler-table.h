@@ -0,0 +1,73 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BLER_TABLE_H_
+#define BLER_TABLE_H_
+
+#include <vector>
+
+/*
+ * BLER curves sampled on a uniform SINR grid, one per channel type and
+ * CQI, so that a BLER lookup is an O(1) linear interpolation instead of a
+ * walk through the BLERvsSINR traces.
+ * The table is empty until Build () or Load () is called; until then, and
+ * for SINR or CQI values outside the table, GetBLER () falls back to
+ * GetBLER_AWGN/GetBLER_TU.
+ */
+class BlerTable
+{
+public:
+  enum ChannelType
+  {
+    CHANNEL_TYPE_AWGN,
+    CHANNEL_TYPE_TU,
+    NB_CHANNEL_TYPES
+  };
+
+  static BlerTable* Init (void);
+
+  void Build (double minSinr = -20, double maxSinr = 40, double step = 0.01);
+  bool Load (const char* fileName);
+  bool Save (const char* fileName);
+  // loads fileName if it holds a table, otherwise builds it and saves it there
+  void LoadOrBuild (const char* fileName);
+
+  bool IsReady (void);
+  double GetBLER (ChannelType type, double sinr, int cqi);
+
+  static const int MIN_CQI = 1;
+  static const int MAX_CQI = 15;
+  // bound on the points per curve of a loaded table (Build () makes 6001)
+  static const int MAX_POINTS = 1000000;
+
+private:
+  BlerTable ();
+  static double GetTraceBLER (ChannelType type, double sinr, int cqi);
+
+  static BlerTable* ptr;
+
+  double m_minSinr;
+  double m_step;
+  int m_nbPoints;
+  // [channel type][cqi - MIN_CQI][sinr point]
+  std::vector<double> m_values;
+};
+
+#endif /* BLER_TABLE_H_ */
@@ -0,0 +1,131 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../channel/LteChannel.h"
+#include "../device/NetworkNode.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+
+/*
+ * Attach/detach cost of the LteChannel device registry.
+ * Usage: channelRegistry [nodes]
+ * Attaches the nodes (one multicast destination every 100), detaches
+ * them in random order, then replays handovers between two channels.
+ * Prints ns per operation and checks that UEs stay before multicast
+ * destinations.
+ */
+static void channelRegistryBenchmark (int argc, char *argv[])
+{
+  int nbNodes = 100000;
+  if (argc > 2)
+    {
+      nbNodes = atoi(argv[2]);
+    }
+
+  vector<NetworkNode*> nodes;
+  for (int i = 0; i < nbNodes; i++)
+    {
+      NetworkNode* node = new NetworkNode ();
+      node->SetIDNetworkNode (i);
+      if (i % 100 == 99)
+        {
+          node->SetNodeType (NetworkNode::TYPE_MULTICAST_DESTINATION);
+        }
+      else
+        {
+          node->SetNodeType (NetworkNode::TYPE_UE);
+        }
+      nodes.push_back (node);
+    }
+  mt19937 generator (1);
+  vector<NetworkNode*> order = nodes;
+  shuffle (order.begin (), order.end (), generator);
+
+  LteChannel* channels [2] = {new LteChannel (), new LteChannel ()};
+  auto check = [&] (LteChannel* channel)
+    {
+      bool multicast = false;
+      for (auto node : *channel->GetDevices ())
+        {
+          bool isMulticast = node->GetNodeType () == NetworkNode::TYPE_MULTICAST_DESTINATION;
+          if (multicast && !isMulticast)
+            {
+              return false;
+            }
+          multicast = isMulticast;
+        }
+      return true;
+    };
+  auto elapsed = [] (chrono::steady_clock::time_point start, int operations)
+    {
+      return chrono::duration<double, nano> (chrono::steady_clock::now () - start).count ()
+             / operations;
+    };
+
+  auto start = chrono::steady_clock::now ();
+  for (auto node : order)
+    {
+      channels [0]->AddDevice (node);
+    }
+  cout << "CHANNEL_REGISTRY ATTACH " << nbNodes << " nodes "
+       << elapsed (start, nbNodes) << " ns/op ordered " << check (channels [0]) << endl;
+
+  shuffle (order.begin (), order.end (), generator);
+  start = chrono::steady_clock::now ();
+  for (auto node : order)
+    {
+      channels [0]->DelDevice (node);
+    }
+  cout << "CHANNEL_REGISTRY DETACH " << nbNodes << " nodes "
+       << elapsed (start, nbNodes) << " ns/op remaining "
+       << channels [0]->GetDevices ()->size () << endl;
+
+  for (auto node : nodes)
+    {
+      channels [0]->AddDevice (node);
+    }
+  int nbHandovers = nbNodes;
+  uniform_int_distribution<int> pick (0, nbNodes - 1);
+  start = chrono::steady_clock::now ();
+  for (int i = 0; i < nbHandovers; i++)
+    {
+      NetworkNode* node = nodes.at (pick (generator));
+      int from = channels [0]->IsAttached (node) ? 0 : 1;
+      channels [from]->DelDevice (node);
+      channels [1 - from]->AddDevice (node);
+    }
+  cout << "CHANNEL_REGISTRY HANDOVER " << nbHandovers << " handovers "
+       << elapsed (start, nbHandovers) << " ns/op ordered "
+       << (check (channels [0]) && check (channels [1]))
+       << " attached " << channels [0]->GetDevices ()->size () + channels [1]->GetDevices ()->size ()
+       << endl;
+
+  delete channels [0];
+  delete channels [1];
+  for (auto node : nodes)
+    {
+      delete node;
+    }
+}
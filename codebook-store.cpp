@@ -0,0 +1,240 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "codebook-store.h"
+#include "mimo-codebook.h"
+#include <iostream>
+#include <stdlib.h>
+
+static const int NB_TX_CONFIGURATIONS = 3; // 2, 4 and 8 TX antennas
+
+CodebookStore* CodebookStore::ptr = nullptr;
+
+CodebookStore::CodebookStore ()
+{
+  m_precoding.resize (NB_TX_CONFIGURATIONS);
+  m_built.resize (NB_TX_CONFIGURATIONS);
+  m_searchPmis.resize (NB_TX_CONFIGURATIONS);
+  for (int a = 0; a < NB_TX_CONFIGURATIONS; a++)
+    {
+      int nbTxAntennas = 2 << a;
+      m_precoding.at (a).resize (nbTxAntennas);
+      m_built.at (a).resize (nbTxAntennas);
+      m_searchPmis.at (a).resize (nbTxAntennas);
+      for (int l = 1; l <= nbTxAntennas; l++)
+        {
+          m_precoding.at (a).at (l - 1).resize (GetMaxPmi (nbTxAntennas) + 1);
+          m_built.at (a).at (l - 1).assign (GetMaxPmi (nbTxAntennas) + 1, false);
+          for (int pmi = 0; pmi <= GetMaxPmi (nbTxAntennas); pmi++)
+            {
+              if (IsInSearchRange (nbTxAntennas, l, pmi))
+                {
+                  m_searchPmis.at (a).at (l - 1).push_back (pmi);
+                  Build (nbTxAntennas, l, pmi);
+                }
+            }
+        }
+    }
+}
+
+CodebookStore::~CodebookStore ()
+{
+}
+
+CodebookStore*
+CodebookStore::Init (void)
+{
+  if (ptr == nullptr)
+    {
+      ptr = new CodebookStore;
+    }
+  return ptr;
+}
+
+int
+CodebookStore::GetAntennaIndex (int nbTxAntennas)
+{
+  switch (nbTxAntennas)
+    {
+    case 2:
+      return 0;
+    case 4:
+      return 1;
+    case 8:
+      return 2;
+    default:
+      std::cout << "Error in CodebookStore: no codebook for " << nbTxAntennas
+                << " TX antennas" << std::endl;
+      exit (1);
+    }
+}
+
+int
+CodebookStore::GetMaxPmi (int nbTxAntennas)
+{
+  switch (nbTxAntennas)
+    {
+    case 2:
+      return 3;
+    case 4:
+      return 15;
+    default:
+      return 255;
+    }
+}
+
+bool
+CodebookStore::IsInSearchRange (int nbTxAntennas, int layers, int pmi)
+{
+  if (nbTxAntennas == 2)
+    {
+      return layers == 1 || (pmi >= 1 && pmi <= 2);
+    }
+  if (nbTxAntennas == 4)
+    {
+      return true;
+    }
+  // limits on i1 and i2 values, depending on layers
+  int i1 = pmi / 16;
+  int i2 = pmi % 16;
+  if ((layers > 2 && i1 > 3) || (layers == 8 && i1 > 0))
+    {
+      return false;
+    }
+  if (layers == 4 && i2 > 7)
+    {
+      return false;
+    }
+  if (layers > 4 && i2 > 0)
+    {
+      return false;
+    }
+  return true;
+}
+
+void
+CodebookStore::Build (int nbTxAntennas, int layers, int pmi)
+{
+  int a = GetAntennaIndex (nbTxAntennas);
+  arma::cx_fmat& precoding = m_precoding.at (a).at (layers - 1).at (pmi);
+  if (nbTxAntennas == 2)
+    {
+      precoding = arma::conv_to<arma::cx_fmat>::from (*mimo_codebook_2tx[pmi][layers - 1]);
+    }
+  else if (nbTxAntennas == 4)
+    {
+      precoding = arma::conv_to<arma::cx_fmat>::from (*mimo_codebook_4tx[pmi][layers - 1]);
+    }
+  else
+    {
+      precoding = arma::conv_to<arma::cx_fmat>::from (codebook_8tx (layers, pmi / 16, pmi % 16));
+    }
+  m_built.at (a).at (layers - 1).at (pmi) = true;
+}
+
+const arma::cx_fmat&
+CodebookStore::GetPrecoding (int nbTxAntennas, int layers, int pmi)
+{
+  int a = GetAntennaIndex (nbTxAntennas);
+  // PMIs signalled by the eNB outside the search range are built on first use
+  if (!m_built.at (a).at (layers - 1).at (pmi))
+    {
+      Build (nbTxAntennas, layers, pmi);
+    }
+  return m_precoding.at (a).at (layers - 1).at (pmi);
+}
+
+const std::vector<int>&
+CodebookStore::GetSearchPmis (int nbTxAntennas, int layers)
+{
+  return m_searchPmis.at (GetAntennaIndex (nbTxAntennas)).at (layers - 1);
+}
+
+bool
+CodebookStore::IsSearchPmi (int nbTxAntennas, int layers, int pmi)
+{
+  return pmi >= 0 && pmi <= GetMaxPmi (nbTxAntennas)
+      && IsInSearchRange (nbTxAntennas, layers, pmi);
+}
+
+void
+CodebookStore::GetFirstStagePmis (int nbTxAntennas, int layers, std::vector<int>& pmis)
+{
+  pmis.clear ();
+  for (int pmi : GetSearchPmis (nbTxAntennas, layers))
+    {
+      if (nbTxAntennas != 8 || pmi % 16 == 0)
+        {
+          pmis.push_back (pmi);
+        }
+    }
+}
+
+void
+CodebookStore::GetSecondStagePmis (int nbTxAntennas, int layers, int pmi, std::vector<int>& pmis)
+{
+  pmis.clear ();
+  for (int candidate : GetSearchPmis (nbTxAntennas, layers))
+    {
+      if (nbTxAntennas != 8 || candidate / 16 == pmi / 16)
+        {
+          pmis.push_back (candidate);
+        }
+    }
+}
+
+void
+CodebookStore::GetNeighbourPmis (int nbTxAntennas, int layers, int pmi, std::vector<int>& pmis)
+{
+  pmis.clear ();
+  if (nbTxAntennas == 8)
+    {
+      int i1 = pmi / 16;
+      int i2 = pmi % 16;
+      for (int d = -2; d <= 2; d++)
+        {
+          if (i2 + d >= 0 && i2 + d < 16 && IsSearchPmi (nbTxAntennas, layers, i1 * 16 + i2 + d))
+            {
+              pmis.push_back (i1 * 16 + i2 + d);
+            }
+        }
+      for (int d = -1; d <= 1; d += 2)
+        {
+          if (IsSearchPmi (nbTxAntennas, layers, (i1 + d) * 16 + i2))
+            {
+              pmis.push_back ((i1 + d) * 16 + i2);
+            }
+        }
+    }
+  else
+    {
+      for (int candidate = pmi - 2; candidate <= pmi + 2; candidate++)
+        {
+          if (IsSearchPmi (nbTxAntennas, layers, candidate))
+            {
+              pmis.push_back (candidate);
+            }
+        }
+    }
+  if (pmis.empty ())
+    {
+      pmis = GetSearchPmis (nbTxAntennas, layers);
+    }
+}
@@ -0,0 +1,69 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CODEBOOK_STORE_H_
+#define CODEBOOK_STORE_H_
+
+#include <vector>
+#include <armadillo>
+
+/*
+ * Single precision copy of the MIMO codebooks for 2, 4 and 8 TX antennas,
+ * built once, so that the PMI search does not convert (or, for 8 TX,
+ * recompute) the precoding matrix of every candidate at every TTI.
+ *
+ * PMIs of the 8 TX codebook are encoded as i1 * 16 + i2.
+ */
+class CodebookStore
+{
+public:
+  static CodebookStore* Init (void);
+
+  const arma::cx_fmat& GetPrecoding (int nbTxAntennas, int layers, int pmi);
+
+  // PMIs scanned by an exhaustive search, in increasing order
+  const std::vector<int>& GetSearchPmis (int nbTxAntennas, int layers);
+  bool IsSearchPmi (int nbTxAntennas, int layers, int pmi);
+  int GetMaxPmi (int nbTxAntennas);
+
+  // search PMIs sharing i2 = 0, one per i1 value (all search PMIs below 8 TX)
+  void GetFirstStagePmis (int nbTxAntennas, int layers, std::vector<int>& pmis);
+  // search PMIs sharing the i1 of pmi (all search PMIs below 8 TX)
+  void GetSecondStagePmis (int nbTxAntennas, int layers, int pmi, std::vector<int>& pmis);
+  // search PMIs close to pmi: i2 +-2 and i1 +-1 for 8 TX, pmi +-2 otherwise
+  void GetNeighbourPmis (int nbTxAntennas, int layers, int pmi, std::vector<int>& pmis);
+
+private:
+  CodebookStore ();
+  virtual ~CodebookStore ();
+
+  static int GetAntennaIndex (int nbTxAntennas);
+  static bool IsInSearchRange (int nbTxAntennas, int layers, int pmi);
+  void Build (int nbTxAntennas, int layers, int pmi);
+
+  static CodebookStore* ptr;
+
+  // [antenna index][layers - 1][pmi]
+  std::vector< std::vector< std::vector<arma::cx_fmat> > > m_precoding;
+  std::vector< std::vector< std::vector<bool> > > m_built;
+  std::vector< std::vector< std::vector<int> > > m_searchPmis;
+};
+
+#endif /* CODEBOOK_STORE_H_ */
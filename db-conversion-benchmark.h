@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../utility/db-conversion.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <math.h>
+
+/*
+ * Microbenchmark of the dB <-> linear kernels used by the PHY.
+ * Usage: dbConversion [subChannels] [iterations]
+ * Prints ns per converted value for scalar libm calls, the exact span
+ * kernel and the fast span kernel, and the error of the fast kernel.
+ */
+static void dbConversionBenchmark (int argc, char *argv[])
+{
+  int nbValues = 100; // sub channels of a 20 MHz carrier
+  int iterations = 100000;
+  if (argc > 2)
+    {
+      nbValues = atoi(argv[2]);
+    }
+  if (argc > 3)
+    {
+      iterations = atoi(argv[3]);
+    }
+
+  // received powers, in dB, spread over the range met in the PHY
+  vector<double> db (nbValues);
+  srand (1);
+  for (auto &v : db)
+    {
+      v = -150 + 200. * rand () / RAND_MAX;
+    }
+  vector<double> linear (nbValues);
+  vector<double> back (nbValues);
+  double checksum = 0;
+
+  auto measure = [&] (void (*toLinear) (const double*, double*, int),
+                      void (*toDb) (const double*, double*, int))
+    {
+      auto start = chrono::steady_clock::now ();
+      for (int it = 0; it < iterations; it++)
+        {
+          toLinear (db.data (), linear.data (), nbValues);
+          toDb (linear.data (), back.data (), nbValues);
+          checksum += back [it % nbValues];
+        }
+      auto stop = chrono::steady_clock::now ();
+      return chrono::duration<double, nano> (stop - start).count ()
+             / ((double) iterations * nbValues * 2);
+    };
+
+  auto scalarToLinear = [] (const double* in, double* out, int n)
+    {
+      for (int i = 0; i < n; i++)
+        {
+          out [i] = pow (10., in [i] / 10.);
+        }
+    };
+  auto scalarToDb = [] (const double* in, double* out, int n)
+    {
+      for (int i = 0; i < n; i++)
+        {
+          out [i] = 10. * log10 (in [i]);
+        }
+    };
+
+  double nsScalar = measure (scalarToLinear, scalarToDb);
+  SetFastDbConversion (false);
+  double nsExact = measure (DbToLinear, LinearToDb);
+  SetFastDbConversion (true);
+  double nsFast = measure (DbToLinear, LinearToDb);
+  SetFastDbConversion (false);
+
+  // accuracy of the fast kernels against libm
+  double maxRelErrorLinear = 0;
+  double maxErrorDb = 0;
+  FastDbToLinear (db.data (), linear.data (), nbValues);
+  FastLinearToDb (linear.data (), back.data (), nbValues);
+  for (int i = 0; i < nbValues; i++)
+    {
+      double exact = pow (10., db.at (i) / 10.);
+      maxRelErrorLinear = max (maxRelErrorLinear, fabs (linear.at (i) / exact - 1));
+      double fastDb;
+      FastLinearToDb (&exact, &fastDb, 1);
+      maxErrorDb = max (maxErrorDb, fabs (fastDb - 10. * log10 (exact)));
+      maxErrorDb = max (maxErrorDb, fabs (back.at (i) - db.at (i)));
+    }
+
+  cout << "DB_CONVERSION values " << nbValues << " iterations " << iterations << endl;
+  cout << "DB_CONVERSION scalar_libm_ns " << nsScalar << endl;
+  cout << "DB_CONVERSION span_exact_ns " << nsExact
+       << " speedup " << nsScalar / nsExact << endl;
+  cout << "DB_CONVERSION span_fast_ns " << nsFast
+       << " speedup " << nsScalar / nsFast << endl;
+  cout << "DB_CONVERSION fast_max_rel_error_linear " << maxRelErrorLinear
+       << " fast_max_error_db " << maxErrorDb << endl;
+  cout << "DB_CONVERSION checksum " << checksum << endl;
+}
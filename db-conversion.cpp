@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "db-conversion.h"
+#include <cstring>
+#include <cstdint>
+
+static bool fastDbConversion = false;
+
+void
+SetFastDbConversion (bool fast)
+{
+  fastDbConversion = fast;
+}
+
+bool
+GetFastDbConversion (void)
+{
+  return fastDbConversion;
+}
+
+void
+DbToLinear (const double* db, double* linear, int n)
+{
+  if (fastDbConversion)
+    {
+      FastDbToLinear (db, linear, n);
+      return;
+    }
+  for (int i = 0; i < n; i++)
+    {
+      linear [i] = pow (10., db [i] / 10.);
+    }
+}
+
+void
+LinearToDb (const double* linear, double* db, int n)
+{
+  if (fastDbConversion)
+    {
+      FastLinearToDb (linear, db, n);
+      return;
+    }
+  for (int i = 0; i < n; i++)
+    {
+      db [i] = 10. * log10 (linear [i]);
+    }
+}
+
+// dB levels whose linear value is a normal double
+static const double FAST_DB_MIN = -3076.;
+static const double FAST_DB_MAX = 3082.;
+static const double DOUBLE_MIN_NORMAL = 2.2250738585072014e-308;
+static const double DOUBLE_MAX = 1.7976931348623157e308;
+
+/*
+ * 10^(x/10) = 2^y, y = x * log2(10) / 10.
+ * y is split into an integer part k, applied to the exponent bits, and a
+ * fraction f in [-0.5, 0.5]; 2^f = e^(f ln2) is evaluated with its Taylor
+ * series up to the 7th power.
+ * Branch free, so that the loop below can be vectorized without
+ * -fno-trapping-math; x must lie within [FAST_DB_MIN, FAST_DB_MAX].
+ */
+static inline double
+FastDbToLinearValue (double x)
+{
+  const double log2_10_over_10 = 0.33219280948873623;
+  const double c1 = 0.69314718055994531;
+  const double c2 = c1 * c1 / 2;
+  const double c3 = c2 * c1 / 3;
+  const double c4 = c3 * c1 / 4;
+  const double c5 = c4 * c1 / 5;
+  const double c6 = c5 * c1 / 6;
+  const double c7 = c6 * c1 / 7;
+
+  double y = x * log2_10_over_10;
+  // round to nearest with the 1.5 * 2^52 trick
+  double k = (y + 6755399441055744.) - 6755399441055744.;
+  double f = y - k;
+  double p = 1. + f * (c1 + f * (c2 + f * (c3 + f * (c4 + f * (c5 + f * (c6 + f * c7))))));
+  // k + 1023 ends up in the low mantissa bits of kb, then becomes the exponent
+  double kb = k + 1023. + 4503599627370496.;
+  int64_t bits;
+  memcpy (&bits, &kb, sizeof (bits));
+  bits <<= 52;
+  double scale;
+  memcpy (&scale, &bits, sizeof (scale));
+  return p * scale;
+}
+
+/*
+ * Inputs outside the domain of the approximation (0 and subnormal
+ * results, -inf, +inf, NaN) are rare: the span is checked first and, when
+ * it holds any, converted value by value with pow for those inputs.
+ */
+void
+FastDbToLinear (const double* db, double* linear, int n)
+{
+  // integer or of the tests, the form the compiler vectorizes
+  int outside = 0;
+  for (int i = 0; i < n; i++)
+    {
+      outside |= (db [i] < FAST_DB_MIN) | (db [i] > FAST_DB_MAX) | (db [i] != db [i]);
+    }
+  if (outside)
+    {
+      for (int i = 0; i < n; i++)
+        {
+          double x = db [i];
+          linear [i] = (x >= FAST_DB_MIN && x <= FAST_DB_MAX)
+              ? FastDbToLinearValue (x) : pow (10., x / 10.);
+        }
+      return;
+    }
+  for (int i = 0; i < n; i++)
+    {
+      linear [i] = FastDbToLinearValue (db [i]);
+    }
+}
+
+/*
+ * 10*log10(x) = 10*log10(2) * log2(x), x = m * 2^e with m in
+ * [sqrt(2)/2, sqrt(2)); log(m) = 2 atanh(t), t = (m-1)/(m+1), |t| < 0.172,
+ * evaluated with the series up to t^9.
+ * Exponent and mantissa are handled on the integer bits, so that there
+ * are no branches; x must be a positive normal number.
+ */
+static inline double
+FastLinearToDbValue (double x)
+{
+  const double ten_log10_2 = 3.0102999566398120;
+  const double inv_ln2 = 1.4426950408889634;
+  const int64_t mantissaMask = 0x000fffffffffffffLL;
+  const int64_t sqrt2Mantissa = 0x0006a09e667f3bcdLL;
+
+  int64_t bits;
+  memcpy (&bits, &x, sizeof (bits));
+  int64_t mantissa = bits & mantissaMask;
+  // 1 if the mantissa is above sqrt(2): m is halved and e incremented
+  int64_t big = mantissa > sqrt2Mantissa;
+  int64_t mbits = mantissa | ((1023 - big) << 52);
+  int64_t ebits = (((bits >> 52) & 0x7ff) + big) | 0x4330000000000000LL;
+  double m, e;
+  memcpy (&m, &mbits, sizeof (m));
+  memcpy (&e, &ebits, sizeof (e));
+  e = e - 4503599627370496. - 1023.;
+
+  double t = (m - 1.) / (m + 1.);
+  double t2 = t * t;
+  double lnm = 2. * t * (1. + t2 * (1. / 3 + t2 * (1. / 5 + t2 * (1. / 7 + t2 * (1. / 9)))));
+  return ten_log10_2 * (e + lnm * inv_ln2);
+}
+
+// 0, subnormals, negative numbers, +inf and NaN go through log10, as in
+// FastDbToLinear
+void
+FastLinearToDb (const double* linear, double* db, int n)
+{
+  int outside = 0;
+  for (int i = 0; i < n; i++)
+    {
+      outside |= (linear [i] < DOUBLE_MIN_NORMAL) | (linear [i] > DOUBLE_MAX)
+          | (linear [i] != linear [i]);
+    }
+  if (outside)
+    {
+      for (int i = 0; i < n; i++)
+        {
+          double x = linear [i];
+          db [i] = (x >= DOUBLE_MIN_NORMAL && x <= DOUBLE_MAX)
+              ? FastLinearToDbValue (x) : 10. * log10 (x);
+        }
+      return;
+    }
+  for (int i = 0; i < n; i++)
+    {
+      db [i] = FastLinearToDbValue (linear [i]);
+    }
+}
@@ -0,0 +1,63 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DB_CONVERSION_H_
+#define DB_CONVERSION_H_
+
+#include <cmath>
+
+/*
+ * Conversions between dB and linear units over whole arrays, used by the
+ * PHY to process all the sub channels of a reception at once.
+ *
+ * By default the kernels call pow/log10 and give the same results as the
+ * scalar code. With SetFastDbConversion (true) they use polynomial
+ * approximations of exp2/log2 written to be vectorized by the compiler.
+ * Both fast kernels stay within 5e-8 dB of libm over the whole range of
+ * normal doubles (measured: 3.1e-8 dB for dB to linear, 3.1e-9 dB for
+ * linear to dB, see db-conversion-benchmark.h). Inputs outside that
+ * range (0, -inf, +inf, NaN, subnormals) give the libm results.
+ */
+
+inline double
+DbToLinear (double db)
+{
+  return pow (10., db / 10.);
+}
+
+inline double
+LinearToDb (double linear)
+{
+  return 10. * log10 (linear);
+}
+
+// linear[i] = 10^(db[i]/10), in-place conversion allowed
+void DbToLinear (const double* db, double* linear, int n);
+// db[i] = 10*log10(linear[i]), in-place conversion allowed
+void LinearToDb (const double* linear, double* db, int n);
+
+void SetFastDbConversion (bool fast);
+bool GetFastDbConversion (void);
+
+// approximated kernels, always available for comparison
+void FastDbToLinear (const double* db, double* linear, int n);
+void FastLinearToDb (const double* linear, double* db, int n);
+
+#endif /* DB_CONVERSION_H_ */
@@ -33,10 +33,15 @@
 #include "interference.h"
 #include "error-model.h"
 #include "../channel/propagation-model/propagation-loss-model.h"
+#include "../channel/propagation-model/channel-realization.h"
 #include "../protocolStack/mac/AMCModule.h"
 #include "../utility/eesm-effective-sinr.h"
 #include "../utility/miesm-effective-sinr.h"
-#include "../componentManagers/FrameManager.h"
+#include "../utility/trace-sink.h"
+#include "../componentManagers/frame-context.h"
+#include "../utility/event-profiler.h"
+#include "../core/eventScheduler/simulator.h"
+#include "ue-lte-phy.h"
 
 
 #define UL_INTERFERENCE 4
@@ -56,6 +61,9 @@ EnbLtePhy::EnbLtePhy()
   GetAntennaParameters ()->SetType(LtePhy::AntennaParameters::ANTENNA_TYPE_OMNIDIRECTIONAL);
   GetAntennaParameters ()->SetBearing(0);
   GetAntennaParameters ()->SetEtilt(15);
+  m_batchedReferenceSymbols = false;
+  m_soundingScheduled = false;
+  m_soundingPerTti = false;
 }
 
 EnbLtePhy::~EnbLtePhy()
@@ -96,7 +104,7 @@ EnbLtePhy::StartTx (shared_ptr<PacketBurst> p)
 {
   //cout << "Node " << GetDevice()->GetIDNetworkNode () << " starts phy tx" << endl;
 
-  if (FrameManager::Init()->MbsfnEnabled()==true && FrameManager::Init()->isMbsfnSubframe()==true)
+  if (FrameContext::Get ().m_mbsfn)
     {
       GetDlMcChannel ()->StartTx (p, GetTxSignal (), GetDevice ());
     }
@@ -109,26 +117,26 @@ EnbLtePhy::StartTx (shared_ptr<PacketBurst> p)
 void
 EnbLtePhy::StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src)
 {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
   cout << "Node " << GetDevice()->GetIDNetworkNode () << " starts phy rx" << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
   //COMPUTE THE SINR
   vector<double> measuredSinr;
   vector<int> channelsForRx;
-  vector<double> rxSignalValues = txSignal->GetValues().at(0);
+  m_rxSignal.LoadFirstPath (txSignal);
 
   double interference = 0;
-  double noise_interference = 10. * log10 (pow(10., GetThermalNoise()/10) + interference); // dB
+  double noise_interference = GetNoiseInterference (interference); // dB
 
-  int chId = 0;
-  for ( auto power : rxSignalValues ) // transmission power for the current sub channel [dB]
+  const double* rxSignalValues = m_rxSignal.GetValues (0);
+  for (int chId = 0; chId < m_rxSignal.GetNbSubChannels (); chId++)
     {
+      double power = rxSignalValues [chId]; // transmission power for the current sub channel [dB]
       if (power != 0.)
         {
           channelsForRx.push_back (chId);
         }
-      chId++;
       measuredSinr.push_back (power - noise_interference - UL_INTERFERENCE);
     }
 
@@ -138,8 +146,12 @@ DEBUG_LOG_END
   vector<int> cqi; //compute the CQI
 
   UserEquipment*eq = (UserEquipment*)src;
-  cout << "\t UE " << eq->GetIDNetworkNode() << " mcs " << eq->GetTargetNodeRecord()->GetUlMcs() <<
-		  " data to translate: " << eq->GetTargetNodeRecord()->m_schedulingRequest << " sinr ";			// by zyb
+  TraceSink* trace = TraceSink::Init ();
+  if (trace->IsEnabled (TraceSink::TRACE_UL_DECODE))
+    {
+      trace->TraceUlDecode (eq->GetIDNetworkNode (), eq->GetTargetNodeRecord ()->GetUlMcs (),
+                            eq->GetTargetNodeRecord ()->m_schedulingRequest);			// by zyb
+    }
   cqi.push_back(eq->GetTargetNodeRecord()->GetUlMcs());
 //  ENodeB* enb = GetDevice();
 //  for (auto record : *enb->GetUserEquipmentRecords ()) {
@@ -152,17 +164,12 @@ DEBUG_LOG_END
   if (GetErrorModel() != nullptr)
     {
 
+    RandomStream::Scope randomScope (GetErrorStream ());
     phyError = GetErrorModel ()->CheckForPhysicalError (channelsForRx, cqi, measuredSinr);
-    if (_PHY_TRACING_)
+    CountPhyError (phyError);
+    if (_PHY_TRACING_ && trace->IsEnabled (TraceSink::TRACE_PHY_ERROR))
       {
-        if (phyError)
-          {
-            cout << "**** YES PHY ERROR (node " << GetDevice ()->GetIDNetworkNode () << ") ****" << endl;
-          }
-        else
-          {
-            cout << "**** NO PHY ERROR (node " << GetDevice ()->GetIDNetworkNode () << ") ****" << endl;
-          }
+        trace->TracePhyError (GetDevice ()->GetIDNetworkNode (), phyError);
       }
     }
 
@@ -170,7 +177,7 @@ DEBUG_LOG_END
   if (!phyError && p->GetNPackets() > 0)
     {
       //FORWARD RECEIVED PACKETS TO THE DEVICE
-      GetDevice()->ReceivePacketBurst(p);
+      GetDevice()->ReceivePacketBurst(p->Copy ());
       eq->GetTargetNodeRecord()->SetUlMcs(-1);
     }
 
@@ -180,26 +187,26 @@ DEBUG_LOG_END
 void
 EnbLtePhy::StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal)
 {
-DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
   cout << "Node " << GetDevice()->GetIDNetworkNode () << " starts phy rx" << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
   //COMPUTE THE SINR
   vector<double> measuredSinr;
   vector<int> channelsForRx;
-  vector<double> rxSignalValues = txSignal->GetValues().at(0);
+  m_rxSignal.LoadFirstPath (txSignal);
 
   double interference = 0;
-  double noise_interference = 10. * log10 (pow(10., GetThermalNoise()/10) + interference); // dB
+  double noise_interference = GetNoiseInterference (interference); // dB
 
-  int chId = 0;
-  for ( auto power : rxSignalValues ) // transmission power for the current sub channel [dB]
+  const double* rxSignalValues = m_rxSignal.GetValues (0);
+  for (int chId = 0; chId < m_rxSignal.GetNbSubChannels (); chId++)
     {
+      double power = rxSignalValues [chId]; // transmission power for the current sub channel [dB]
       if (power != 0.)
         {
           channelsForRx.push_back (chId);
         }
-      chId++;
       measuredSinr.push_back (power - noise_interference - UL_INTERFERENCE);
     }
 
@@ -227,12 +234,47 @@ DEBUG_LOG_END
   if (!phyError && p->GetNPackets() > 0)
     {
       //FORWARD RECEIVED PACKETS TO THE DEVICE
-      GetDevice()->ReceivePacketBurst(p);
+      GetDevice()->ReceivePacketBurst(p->Copy ());
     }
 
   delete txSignal;
 }
 
+/*
+ * Indices of the records of each UE of an allocation map, UEs being listed
+ * in order of first appearance. The containers are reused between TTIs.
+ */
+template <class Records>
+static void
+GroupAllocationsByUe (Records* records, vector<NetworkNode*>& ues,
+                      vector< vector<int> >& indices, unordered_map<int, int>& slots)
+{
+  ues.clear ();
+  slots.clear ();
+  for (int i = 0; i < (int) records->size (); i++)
+    {
+      NetworkNode* ue = records->at (i).m_ue;
+      auto it = slots.find (ue->GetIDNetworkNode ());
+      int slot;
+      if (it == slots.end ())
+        {
+          slot = ues.size ();
+          slots [ue->GetIDNetworkNode ()] = slot;
+          ues.push_back (ue);
+          if ((int) indices.size () <= slot)
+            {
+              indices.resize (slot + 1);
+            }
+          indices.at (slot).clear ();
+        }
+      else
+        {
+          slot = it->second;
+        }
+      indices.at (slot).push_back (i);
+    }
+}
+
 void
 EnbLtePhy::SendIdealControlMessage (IdealControlMessage *msg)
 {
@@ -242,9 +284,20 @@ EnbLtePhy::SendIdealControlMessage (IdealControlMessage *msg)
     case IdealControlMessage::ALLOCATION_MAP:
         {
           PdcchMapIdealControlMessage *pdcchMsg =  (PdcchMapIdealControlMessage*)msg;
-          for (auto record : *pdcchMsg->GetMessage())
+          GroupAllocationsByUe (pdcchMsg->GetMessage (), m_allocatedUes,
+                                m_allocationsByUe, m_allocatedUeSlots);
+          for (int i = 0; i < (int) m_allocatedUes.size (); i++)
             {
-              record.m_ue->GetPhy ()->ReceiveIdealControlMessage (msg);
+              NetworkNode* ue = m_allocatedUes.at (i);
+              if (ue->GetNodeType () == NetworkNode::TYPE_UE)
+                {
+                  ((UeLtePhy*) ue->GetPhy ())->
+                      ReceiveAllocationMap (pdcchMsg, m_allocationsByUe.at (i));
+                }
+              else
+                {
+                  ue->GetPhy ()->ReceiveIdealControlMessage (msg);
+                }
             }
         }
       break;
@@ -252,9 +305,20 @@ EnbLtePhy::SendIdealControlMessage (IdealControlMessage *msg)
     case IdealControlMessage::NB_IOT_ALLOCATION_MAP:
         {
           NbIoTMapIdealControlMessage *pdcchMsg =  (NbIoTMapIdealControlMessage*)msg;
-          for (auto record : *pdcchMsg->GetMessage())
+          GroupAllocationsByUe (pdcchMsg->GetMessage (), m_allocatedUes,
+                                m_allocationsByUe, m_allocatedUeSlots);
+          for (int i = 0; i < (int) m_allocatedUes.size (); i++)
             {
-              record.m_ue->GetPhy ()->ReceiveIdealControlMessage (msg);
+              NetworkNode* ue = m_allocatedUes.at (i);
+              if (ue->GetNodeType () == NetworkNode::TYPE_UE)
+                {
+                  ((UeLtePhy*) ue->GetPhy ())->
+                      ReceiveNbIoTAllocationMap (pdcchMsg, m_allocationsByUe.at (i));
+                }
+              else
+                {
+                  ue->GetPhy ()->ReceiveIdealControlMessage (msg);
+                }
             }
         }
       break;
@@ -283,6 +347,13 @@ void
 EnbLtePhy::ReceiveReferenceSymbols (NetworkNode* n, TransmittedSignal* s)
 {
   ENodeB::UserEquipmentRecord* user = ((UserEquipment*) n)->GetTargetNodeRecord();
+  ComputeUplinkQuality (n, s, m_ulQuality);
+  user->SetUplinkChannelStatusIndicator (m_ulQuality);
+}
+
+void
+EnbLtePhy::ComputeUplinkQuality (NetworkNode* n, TransmittedSignal* s, vector<double>& ulQuality)
+{
   ReceivedSignal* rxSignal;
   if (GetUlChannel ()->GetPropagationLossModel () != nullptr)
     {
@@ -293,18 +364,23 @@ EnbLtePhy::ReceiveReferenceSymbols (NetworkNode* n, TransmittedSignal* s)
     {
       rxSignal = s->Copy ();
     }
-  AMCModule* amc = user->GetUE()->GetProtocolStack ()->GetMacEntity ()->GetAmcModule ();
-  vector<double> ulQuality;
-  vector<double> rxSignalValues = rxSignal->GetValues ().at(0);
+  // the SINR is written in place into ulQuality, from path 0 of the
+  // received signal, without loading it into m_rxSignal first
+  double noise_interference = GetNoiseInterference (0); // dB
+  {
+    const vector< vector<double> >& rxSignalValues = rxSignal->GetValues ();
+    const vector<double>& firstPath = rxSignalValues.at (0);
+    ulQuality.resize (firstPath.size ());
+    for (int i = 0; i < (int) firstPath.size (); i++)
+      {
+        ulQuality [i] = firstPath [i] - noise_interference - UL_INTERFERENCE;
+      }
+  }
   delete rxSignal;
-  double noise_interference = 10. * log10 (pow(10., GetThermalNoise()/10)); // dB
-  for (auto power : rxSignalValues)
-    {
-      ulQuality.push_back (power - noise_interference - UL_INTERFERENCE);
-    }
 
 
-DEBUG_LOG_START_1(LTE_SIM_TEST_UL_SINR)
+DEBUG_TRACE_START(DEBUG_UL_SINR)
+  AMCModule* amc = ((UserEquipment*) n)->GetProtocolStack ()->GetMacEntity ()->GetAmcModule ();
   double effectiveSinr = GetMiesmEffectiveSinr (ulQuality);
   if (effectiveSinr > 40) effectiveSinr = 40;
   int mcs = amc->GetMCSFromCQI (amc->GetCQIFromSinr(effectiveSinr));
@@ -312,10 +388,111 @@ DEBUG_LOG_START_1(LTE_SIM_TEST_UL_SINR)
             << n->GetMobilityModel ()->GetAbsolutePosition()->GetCoordinateX () << " "
             << n->GetMobilityModel ()->GetAbsolutePosition()->GetCoordinateY () << " "
             << effectiveSinr << " " << mcs << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
+}
 
+void
+EnbLtePhy::SetBatchedReferenceSymbols (bool b)
+{
+  m_batchedReferenceSymbols = b;
+}
 
-  user->SetUplinkChannelStatusIndicator (ulQuality);
+bool
+EnbLtePhy::GetBatchedReferenceSymbols (void)
+{
+  return m_batchedReferenceSymbols;
+}
+
+void
+EnbLtePhy::AddSoundingUe (UserEquipment* ue)
+{
+  if (!m_soundingUeIds.insert (ue->GetIDNetworkNode ()).second)
+    {
+      return;
+    }
+  m_soundingUes.push_back (ue);
+
+  // first sounding at registration time, as in the per UE mode
+  UeLtePhy* uePhy = (UeLtePhy*) ue->GetPhy ();
+  ReceiveReferenceSymbols (ue, uePhy->GetTxSignalForReferenceSymbols ());
+
+  if (!m_soundingScheduled)
+    {
+      ScheduleSoundingBatch ();
+    }
+}
+
+void
+EnbLtePhy::ReceiveReferenceSymbolsBatch (void)
+{
+  EventProfiler::Scope profile ("EnbLtePhy::ReceiveReferenceSymbolsBatch");
+  m_soundingScheduled = false;
+
+  // UEs keep sounding under the same conditions checked by
+  // UeLtePhy::SendReferenceSymbols. UEs handed over leave the batch and
+  // sound towards their new eNB, batched or not, as that eNB is set up.
+  vector<UserEquipment*> soundingUes;
+  soundingUes.swap (m_soundingUes);
+  m_soundingUes.reserve (soundingUes.size ());
+  for (auto ue : soundingUes)
+    {
+      ENodeB* target = ue->GetTargetNode ();
+      UeLtePhy* uePhy = (UeLtePhy*) ue->GetPhy ();
+      if ((EnbLtePhy*) target->GetPhy () != this)
+        {
+          m_soundingUeIds.erase (ue->GetIDNetworkNode ());
+          uePhy->SendReferenceSymbols ();
+          continue;
+        }
+      ChannelRealization* cr = uePhy->GetUlChannel ()->GetPropagationLossModel ()->GetChannelRealization (ue, target);
+      if (cr == nullptr || target->GetDLScheduler () == nullptr || cr->hasFastFading () == false)
+        {
+          m_soundingUeIds.erase (ue->GetIDNetworkNode ());
+          continue;
+        }
+      ComputeUplinkQuality (ue, uePhy->GetTxSignalForReferenceSymbols (), m_ulQuality);
+      ue->GetTargetNodeRecord ()->SetUplinkChannelStatusIndicator (m_ulQuality);
+      m_soundingUes.push_back (ue);
+    }
+
+  if (m_soundingUes.size () > 0 && !m_soundingScheduled)
+    {
+      ScheduleSoundingBatch ();
+    }
+}
+
+void
+EnbLtePhy::ScheduleSoundingBatch (void)
+{
+  double delay = 0.001;
+  if (m_soundingPerTti)
+    {
+      // 1 ms before the next TTI boundary (TTIs start at time 0): the
+      // schedulers of that TTI read CSI at most 1 ms old, as with one
+      // sounding per ms
+      double tti = FrameContext::Get ().m_ttiLength / 1000.;
+      double now = Simulator::Init()->Now ();
+      double boundary = (floor (now / tti + 1e-9) + 1) * tti;
+      delay = boundary - 0.001 - now;
+      if (delay < 1e-9)
+        {
+          delay += tti;
+        }
+    }
+  m_soundingScheduled = true;
+  Simulator::Init()->Schedule(delay, &EnbLtePhy::ReceiveReferenceSymbolsBatch, this);
+}
+
+void
+EnbLtePhy::SetSoundingPerTti (bool b)
+{
+  m_soundingPerTti = b;
+}
+
+bool
+EnbLtePhy::GetSoundingPerTti (void)
+{
+  return m_soundingPerTti;
 }
 
 
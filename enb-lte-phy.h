@@ -24,9 +24,13 @@
 #define ENB_LTE_PHY_H_
 
 #include "lte-phy.h"
+#include "rx-signal-buffer.h"
+#include <unordered_map>
+#include <unordered_set>
 
 class IdealControlMessage;
 class ENodeB;
+class UserEquipment;
 
 class EnbLtePhy :public LtePhy
 {
@@ -45,9 +49,43 @@ public:
 
   void ReceiveReferenceSymbols (NetworkNode* n, TransmittedSignal* s);
 
+  /*
+   * Batched uplink sounding: instead of one event per UE per TTI, the UEs
+   * register here and a single event per TTI receives the reference
+   * symbols of all of them.
+   */
+  void SetBatchedReferenceSymbols (bool b);
+  bool GetBatchedReferenceSymbols (void);
+  void AddSoundingUe (UserEquipment* ue);
+  void ReceiveReferenceSymbolsBatch (void);
+  /*
+   * With sounding per TTI, the batch runs once per TTI, 1 ms before each
+   * TTI boundary, instead of every ms. The schedulers read the UL CSI
+   * once per TTI, so with long TTIs (32 ms in NB-IoT) the other soundings
+   * were overwritten unread. Off by default.
+   */
+  void SetSoundingPerTti (bool b);
+  bool GetSoundingPerTti (void);
+
   ENodeB* GetDevice(void);
 private:
+  void ComputeUplinkQuality (NetworkNode* n, TransmittedSignal* s, vector<double>& ulQuality);
+  void ScheduleSoundingBatch (void);
+
   vector<int> m_mcsIndexForRx;
+  RxSignalBuffer m_rxSignal;
+
+  bool m_batchedReferenceSymbols;
+  bool m_soundingScheduled;
+  bool m_soundingPerTti;
+  vector<UserEquipment*> m_soundingUes;
+  unordered_set<int> m_soundingUeIds; // node IDs of m_soundingUes
+  vector<double> m_ulQuality;
+
+  // allocation map records grouped by UE, in order of first appearance
+  vector<NetworkNode*> m_allocatedUes;
+  vector< vector<int> > m_allocationsByUe;
+  unordered_map<int, int> m_allocatedUeSlots;
 
 };
 
@@ -0,0 +1,214 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "event-profiler.h"
+#include "../core/eventScheduler/simulator.h"
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+// the Chrome trace keeps the first calls only, beyond that the summary
+// still counts every call
+static const size_t MAX_TRACE_EVENTS = 4000000;
+
+EventProfiler* EventProfiler::ptr = nullptr;
+
+EventProfiler::EventProfiler ()
+{
+  m_enabled = false;
+  m_dumped = false;
+  m_origin = std::chrono::steady_clock::now ();
+
+  const char* profile = std::getenv ("LTE_SIM_EVENT_PROFILE");
+  if (profile != nullptr)
+    {
+      bool toFile = strlen (profile) > 0 && strcmp (profile, "1") != 0;
+      Enable (toFile ? profile : nullptr);
+    }
+}
+
+EventProfiler*
+EventProfiler::Init (void)
+{
+  if (ptr == nullptr)
+    {
+      ptr = new EventProfiler;
+      atexit ([]
+        {
+          ptr->Dump ();
+        });
+    }
+  return ptr;
+}
+
+void
+EventProfiler::Enable (const char* chromeTraceFile)
+{
+  m_enabled = true;
+  m_chromeTraceFile = (chromeTraceFile != nullptr) ? chromeTraceFile : "";
+}
+
+void
+EventProfiler::Disable (void)
+{
+  m_enabled = false;
+}
+
+void
+EventProfiler::Record (const char* type, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point stop)
+{
+  int index;
+  auto cached = m_typeIndexCache.find (type);
+  if (cached != m_typeIndexCache.end ())
+    {
+      index = cached->second;
+    }
+  else
+    {
+      // first call from this literal, maybe not from this name
+      auto it = m_typeIndex.find (type);
+      if (it == m_typeIndex.end ())
+        {
+          index = m_types.size ();
+          m_typeIndex [type] = index;
+          TypeStats stats;
+          stats.name = type;
+          stats.calls = 0;
+          stats.totalNs = 0;
+          stats.selfNs = 0;
+          stats.maxNs = 0;
+          memset (stats.histogram, 0, sizeof (stats.histogram));
+          m_types.push_back (stats);
+        }
+      else
+        {
+          index = it->second;
+        }
+      m_typeIndexCache [type] = index;
+    }
+
+  double ns = std::chrono::duration<double, std::nano> (stop - start).count ();
+  double childNs = m_childNs.back ();
+  m_childNs.pop_back ();
+  if (!m_childNs.empty ())
+    {
+      m_childNs.back () += ns;
+    }
+  TypeStats& stats = m_types [index];
+  stats.calls++;
+  stats.totalNs += ns;
+  stats.selfNs += ns - childNs;
+  stats.maxNs = std::max (stats.maxNs, ns);
+  int bin = (ns < 1) ? 0 : std::min ((int) std::log2 (ns), NB_HISTOGRAM_BINS - 1);
+  stats.histogram [bin]++;
+
+  if (!m_chromeTraceFile.empty () && m_trace.size () < MAX_TRACE_EVENTS)
+    {
+      TraceEvent event;
+      event.type = index;
+      event.startUs = std::chrono::duration<double, std::micro> (start - m_origin).count ();
+      event.durationUs = ns / 1000;
+      event.simulatedTime = Simulator::Init ()->Now ();
+      m_trace.push_back (event);
+    }
+}
+
+void
+EventProfiler::PrintSummary (std::ostream& out)
+{
+  std::vector<TypeStats> types = m_types;
+  std::sort (types.begin (), types.end (), [] (const TypeStats& a, const TypeStats& b)
+    {
+      return a.selfNs > b.selfNs;
+    });
+  double selfNs = 0;
+  for (auto& stats : types)
+    {
+      selfNs += stats.selfNs;
+    }
+
+  for (auto& stats : types)
+    {
+      out << "EVENT_PROFILE " << stats.name
+          << " calls " << stats.calls
+          << " total_ms " << stats.totalNs / 1e6
+          << " self_ms " << stats.selfNs / 1e6
+          << " share " << (selfNs > 0 ? stats.selfNs / selfNs : 0)
+          << " mean_ns " << stats.totalNs / stats.calls
+          << " max_ns " << stats.maxNs << std::endl;
+      out << "EVENT_PROFILE_HISTOGRAM " << stats.name;
+      for (int bin = 0; bin < NB_HISTOGRAM_BINS; bin++)
+        {
+          if (stats.histogram [bin] > 0)
+            {
+              out << " " << (1ULL << bin) << "ns:" << stats.histogram [bin];
+            }
+        }
+      out << std::endl;
+    }
+}
+
+bool
+EventProfiler::WriteChromeTrace (void)
+{
+  if (m_chromeTraceFile.empty ())
+    {
+      return false;
+    }
+  std::ofstream out (m_chromeTraceFile.c_str ());
+  if (!out.is_open ())
+    {
+      std::cout << "Error in EventProfiler::WriteChromeTrace: cannot open "
+                << m_chromeTraceFile << std::endl;
+      return false;
+    }
+  // times in us with ns resolution, the default 6 significant digits
+  // would round them to the second after a few seconds of run
+  out << std::fixed << std::setprecision (3);
+  out << "{\"traceEvents\":[" << std::endl;
+  for (size_t i = 0; i < m_trace.size (); i++)
+    {
+      const TraceEvent& event = m_trace [i];
+      out << "{\"name\":\"" << m_types [event.type].name
+          << "\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+          << ",\"ts\":" << event.startUs
+          << ",\"dur\":" << event.durationUs
+          << ",\"args\":{\"sim_time\":" << event.simulatedTime << "}}"
+          << (i + 1 < m_trace.size () ? "," : "") << std::endl;
+    }
+  out << "],\"displayTimeUnit\":\"ns\"}" << std::endl;
+  return true;
+}
+
+void
+EventProfiler::Dump (void)
+{
+  if (m_dumped || m_types.size () == 0)
+    {
+      return;
+    }
+  m_dumped = true;
+  PrintSummary (std::cout);
+  WriteChromeTrace ();
+}
@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EVENT_PROFILER_H_
+#define EVENT_PROFILER_H_
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <unordered_map>
+
+/*
+ * Per event type profiling of simulator callbacks.
+ *
+ * A callback opens an EventProfiler::Scope named after itself; the
+ * profiler counts the calls of each type and accumulates their execution
+ * time, with a log2 histogram of the durations in ns. Types are told
+ * apart by name, so the same name used in several files is one type.
+ * A scope opened inside another one counts in the total time of both,
+ * but only in the self time of the inner one: the shares of the summary
+ * are shares of self time and add up to 1.
+ * When disabled (default) a Scope costs one test of a flag.
+ *
+ * Enabled with Enable () or with the LTE_SIM_EVENT_PROFILE environment
+ * variable. Dump () prints the summary and, when the variable names a
+ * file, writes every call there in the Chrome trace event format
+ * (chrome://tracing, Perfetto), with the simulated time in its arguments.
+ * Scenarios call Dump () when the simulation stops; otherwise it runs on
+ * exit. Scopes must be opened from the simulator thread. Only the
+ * callbacks that open a Scope are seen: the Simulator loop itself, and
+ * so the depth of its queue, is outside the profiler.
+ */
+class EventProfiler
+{
+public:
+  static EventProfiler* Init (void);
+
+  bool IsEnabled (void)
+  {
+    return m_enabled;
+  }
+  void Enable (const char* chromeTraceFile = nullptr);
+  void Disable (void);
+
+  class Scope
+  {
+  public:
+    // type must be a string literal
+    Scope (const char* type)
+    {
+      EventProfiler* profiler = (ptr != nullptr) ? ptr : EventProfiler::Init ();
+      m_profiler = profiler->IsEnabled () ? profiler : nullptr;
+      if (m_profiler != nullptr)
+        {
+          m_profiler->Enter ();
+          m_type = type;
+          m_start = std::chrono::steady_clock::now ();
+        }
+    }
+    ~Scope ()
+    {
+      if (m_profiler != nullptr)
+        {
+          m_profiler->Record (m_type, m_start, std::chrono::steady_clock::now ());
+        }
+    }
+  private:
+    EventProfiler* m_profiler;
+    const char* m_type;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  // a Scope opens with Enter () and closes with Record ()
+  void Enter (void)
+  {
+    m_childNs.push_back (0);
+  }
+  void Record (const char* type, std::chrono::steady_clock::time_point start,
+               std::chrono::steady_clock::time_point stop);
+
+  void PrintSummary (std::ostream& out);
+  bool WriteChromeTrace (void);
+  // summary to stdout and Chrome trace, once
+  void Dump (void);
+
+  static const int NB_HISTOGRAM_BINS = 32; // bin i: [2^i, 2^(i+1)) ns
+
+private:
+  EventProfiler ();
+
+  struct TypeStats
+  {
+    std::string name;
+    unsigned long long calls;
+    double totalNs;
+    double selfNs; // totalNs less the time of the nested scopes
+    double maxNs;
+    unsigned long long histogram [NB_HISTOGRAM_BINS];
+  };
+  struct TraceEvent
+  {
+    int type; // index in m_types
+    double startUs;
+    double durationUs;
+    double simulatedTime;
+  };
+
+  static EventProfiler* ptr;
+
+  bool m_enabled;
+  bool m_dumped;
+  std::chrono::steady_clock::time_point m_origin;
+  std::unordered_map<std::string, int> m_typeIndex;
+  // by address, in front of m_typeIndex
+  std::unordered_map<const char*, int> m_typeIndexCache;
+  std::vector<TypeStats> m_types;
+  // time spent in the nested scopes of each open scope, innermost last
+  std::vector<double> m_childNs;
+  std::string m_chromeTraceFile;
+  std::vector<TraceEvent> m_trace;
+};
+
+#endif /* EVENT_PROFILER_H_ */
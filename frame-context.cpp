@@ -0,0 +1,43 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "frame-context.h"
+#include "FrameManager.h"
+
+static thread_local FrameContext context;
+static thread_local bool contextValid = false;
+
+const FrameContext&
+FrameContext::Get (void)
+{
+  FrameManager* frameManager = FrameManager::Init ();
+  unsigned long tti = frameManager->GetTTICounter ();
+  if (!contextValid || context.m_tti != tti)
+    {
+      context.m_tti = tti;
+      context.m_mbsfnEnabled = frameManager->MbsfnEnabled ();
+      context.m_mbsfnSubframe = frameManager->isMbsfnSubframe ();
+      context.m_mbsfn = context.m_mbsfnEnabled && context.m_mbsfnSubframe;
+      context.m_ttiLength = frameManager->getTTILength ();
+      context.m_coverShiftIndex = frameManager->GetCoverShiftIndex ();
+      contextValid = true;
+    }
+  return context;
+}
@@ -0,0 +1,46 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FRAME_CONTEXT_H_
+#define FRAME_CONTEXT_H_
+
+/*
+ * State of the current TTI, as seen by the FrameManager, read once per
+ * TTI and then shared by every transmission and reception of that TTI.
+ *
+ * Get () refreshes the context when the TTI counter of the FrameManager
+ * has moved, so it stays correct whatever the order of the events within
+ * a TTI. The cache is per thread: a thread driving its own frame timeline
+ * never sees the context of another one.
+ */
+struct FrameContext
+{
+  unsigned long m_tti;
+  bool m_mbsfnEnabled;
+  bool m_mbsfnSubframe;
+  // m_mbsfnEnabled && m_mbsfnSubframe: MBSFN transmission in this TTI
+  bool m_mbsfn;
+  double m_ttiLength; // ms
+  int m_coverShiftIndex;
+
+  static const FrameContext& Get (void);
+};
+
+#endif /* FRAME_CONTEXT_H_ */
@@ -29,6 +29,7 @@
 #include "../core/spectrum/transmitted-signal.h"
 #include "interference.h"
 #include "error-model.h"
+#include "../utility/db-conversion.h"
 
 LtePhy::LtePhy()
 {
@@ -68,13 +69,29 @@ LtePhy::Destroy (void)
   delete m_txSignal;
   delete m_interference;
   delete m_errorModel;
+  // ~LtePhy runs after the subclass destructors call Destroy ()
+  m_txSignal = nullptr;
+  m_interference = nullptr;
+  m_errorModel = nullptr;
 }
 
 
+bool
+LtePhy::IsRxNeeded (TransmittedSignal* txSignal, NetworkNode* src)
+{
+  return true;
+}
+
 void
 LtePhy::SetDevice (NetworkNode* d)
 {
   m_device = d;
+  // the PHY constructors run before the device is attached: the stream
+  // is keyed when the device is set
+  if (d != nullptr)
+    {
+      m_errorStream.SetKey (d->GetIDNetworkNode (), RandomStream::RANDOM_BLER);
+    }
 }
 
 NetworkNode*
@@ -231,6 +248,29 @@ LtePhy::GetErrorModel (void)
   return m_errorModel;
 }
 
+RandomStream*
+LtePhy::GetErrorStream (void)
+{
+  return &m_errorStream;
+}
+
+long long LtePhy::m_nbPhyErrors = 0;
+
+void
+LtePhy::CountPhyError (bool phyError)
+{
+  if (phyError)
+    {
+      m_nbPhyErrors++;
+    }
+}
+
+long long
+LtePhy::GetNbPhyErrors (void)
+{
+  return m_nbPhyErrors;
+}
+
 LtePhy::AntennaParameters* LtePhy::GetAntennaParameters (void)
 {
   return m_antennaParameters;
@@ -357,6 +397,8 @@ LtePhy::SetNoiseFigure(double nf)
    *  noise_db = noise figure + n0 + 10log10 (180000) - 30
    */
   m_thermalNoise = m_noiseFigure - 174 + 10*log10(180000) - 30;
+  m_thermalNoiseLinear = DbToLinear (m_thermalNoise);
+  m_noiseInterferenceValid = false;
 }
 
 double
@@ -371,6 +413,29 @@ LtePhy::GetThermalNoise(void)
   return m_thermalNoise;
 }
 
+double
+LtePhy::GetThermalNoiseLinear(void)
+{
+  return m_thermalNoiseLinear;
+}
+
+double
+LtePhy::GetNoiseInterference(double interference)
+{
+  /*
+   * The interference seen by a node only changes when the set or the power
+   * of its interferers does, so the last sum is reused as long as the same
+   * interference comes back (always, for nodes without interference).
+   */
+  if (!m_noiseInterferenceValid || interference != m_lastInterference)
+    {
+      m_lastInterference = interference;
+      m_noiseInterference = LinearToDb (m_thermalNoiseLinear + interference);
+      m_noiseInterferenceValid = true;
+    }
+  return m_noiseInterference;
+}
+
 void
 LtePhy::SetAverageBuildingHeight(double height)
 {
@@ -26,6 +26,7 @@
 
 #include <memory>
 #include "../load-parameters.h"
+#include "../utility/random-stream.h"
 
 class NetworkNode;
 class LteChannel;
@@ -45,9 +46,17 @@ public:
   void Destroy (void);
 
   virtual void StartTx (shared_ptr<PacketBurst> p) = 0;
+  // p is shared by every receiver of the transmission and must not be
+  // modified: copy it before handing it to the protocol stack. The copy
+  // is a deep one, made for each receiver that decodes the burst, since
+  // the stack (outside the PHY) may strip headers from its packets
   virtual void StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal) = 0;
   virtual void StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src) = 0;		// by zyb
 
+  // false when StartRx would drop txSignal without looking at it: the
+  // channel then skips the propagation loss and the delivery
+  virtual bool IsRxNeeded (TransmittedSignal* txSignal, NetworkNode* src);
+
   void SetDevice (NetworkNode* d);
   NetworkNode* GetDevice (void);
 
@@ -89,12 +98,22 @@ public:
   void SetNoiseFigure(double nf);
   double GetNoiseFigure(void);
   double GetThermalNoise(void);
+  double GetThermalNoiseLinear(void);
+  // noise + interference [dB], interference in linear units
+  double GetNoiseInterference(double interference);
 
   void SetAverageBuildingHeight(double height);
   double GetAverageBuildingHeight(void);
 
   Interference* GetInterference (void);
   ErrorModel* GetErrorModel (void);
+  // RANDOM_BLER stream of the device, lent to the error model with a
+  // RandomStream::Scope around CheckForPhysicalError
+  RandomStream* GetErrorStream (void);
+  // process-wide count of the receptions the error model failed, kept
+  // whether or not PHY error tracing is on
+  static void CountPhyError (bool phyError);
+  static long long GetNbPhyErrors (void);
 
   struct AntennaParameters
   {
@@ -173,6 +192,10 @@ private:
   TransmittedSignal* m_txSignal;
   double m_noiseFigure;
   double m_thermalNoise;
+  double m_thermalNoiseLinear;
+  double m_lastInterference;
+  double m_noiseInterference;
+  bool m_noiseInterferenceValid;
   double m_averageBuildingHeight;
 
   int m_txAntennas;
@@ -181,8 +204,11 @@ private:
 
   Interference *m_interference;
   ErrorModel *m_errorModel;
+  RandomStream m_errorStream;
   WaveformType m_waveform;
   bool m_useSrtaPi;
+
+  static long long m_nbPhyErrors;
 };
 
 #endif /* LTE_PHY_H_ */
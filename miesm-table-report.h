@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../utility/miesm-table.h"
+#include "../utility/miesm-effective-sinr.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+
+/*
+ * Accuracy report of the MIESM tables.
+ * Usage: miesmTable [spans]
+ * Random spans of 1 to 100 sub channel SINRs are mapped to an effective
+ * SINR through each table and through the reference implementation:
+ * GetMiesmEffectiveSinr for MODULATION_DEFAULT, the exact MMIB curve
+ * inverted by bisection for the other modulations. Prints mean, 99th
+ * percentile and maximum error in dB and ns per call.
+ * For the DEFAULT table, the maximum error measured on these spans against
+ * GetMiesmEffectiveSinr must stay within MiesmTable::MAX_ERROR, as must
+ * MiesmTable::GetMaxError (the check SetMiesmTable (true) runs): the
+ * report prints MIESM_TABLE_CHECK FAIL and exits with status 1 otherwise.
+ */
+static double
+MmibEffectiveSinr (MiesmTable::Modulation m, const vector<double>& sinr)
+{
+  double mi = 0;
+  for (auto s : sinr)
+    {
+      s = min (max (s, MiesmTable::MIN_SINR), MiesmTable::MAX_SINR);
+      mi += MiesmTable::GetMmibMutualInformation (m, s);
+    }
+  mi /= sinr.size ();
+  double low = MiesmTable::MIN_SINR;
+  double high = MiesmTable::MAX_SINR;
+  for (int it = 0; it < 60; it++)
+    {
+      double mid = (low + high) / 2;
+      if (MiesmTable::GetMmibMutualInformation (m, mid) < mi)
+        {
+          low = mid;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+  return high;
+}
+
+static void miesmTableReport (int argc, char *argv[])
+{
+  int nbSpans = 20000;
+  if (argc > 2)
+    {
+      nbSpans = atoi(argv[2]);
+    }
+
+  srand (1);
+  vector< vector<double> > spans (nbSpans);
+  for (auto &span : spans)
+    {
+      span.resize (1 + rand () % 100);
+      // fading around a random average SINR
+      double average = -10 + 35. * rand () / RAND_MAX;
+      for (auto &s : span)
+        {
+          s = average - 10 + 20. * rand () / RAND_MAX;
+        }
+    }
+
+  const char* names [] = {"DEFAULT", "QPSK", "16QAM", "64QAM"};
+  for (int m = 0; m < MiesmTable::NB_MODULATIONS; m++)
+    {
+      MiesmTable::Modulation modulation = (MiesmTable::Modulation) m;
+      auto start = chrono::steady_clock::now ();
+      MiesmTable* table = MiesmTable::Init (modulation);
+      auto stop = chrono::steady_clock::now ();
+      double buildMs = chrono::duration<double, milli> (stop - start).count ();
+
+      vector<double> reference (nbSpans);
+      start = chrono::steady_clock::now ();
+      for (int i = 0; i < nbSpans; i++)
+        {
+          if (modulation == MiesmTable::MODULATION_DEFAULT)
+            {
+              reference.at (i) = GetMiesmEffectiveSinr (spans.at (i));
+            }
+          else
+            {
+              reference.at (i) = MmibEffectiveSinr (modulation, spans.at (i));
+            }
+        }
+      stop = chrono::steady_clock::now ();
+      double referenceNs = chrono::duration<double, nano> (stop - start).count () / nbSpans;
+
+      vector<double> tabulated (nbSpans);
+      start = chrono::steady_clock::now ();
+      for (int i = 0; i < nbSpans; i++)
+        {
+          tabulated.at (i) = table->GetEffectiveSinr (spans.at (i));
+        }
+      stop = chrono::steady_clock::now ();
+      double tableNs = chrono::duration<double, nano> (stop - start).count () / nbSpans;
+
+      vector<double> errors (nbSpans);
+      double meanError = 0;
+      for (int i = 0; i < nbSpans; i++)
+        {
+          errors.at (i) = fabs (tabulated.at (i) - reference.at (i));
+          meanError += errors.at (i) / nbSpans;
+        }
+      sort (errors.begin (), errors.end ());
+
+      cout << "MIESM_TABLE " << names [m]
+           << " spans " << nbSpans
+           << " build_ms " << buildMs
+           << " reference_ns " << referenceNs
+           << " table_ns " << tableNs
+           << " mean_error_db " << meanError
+           << " p99_error_db " << errors.at ((int) (0.99 * (nbSpans - 1)))
+           << " max_error_db " << errors.back ();
+      cout << endl;
+
+      if (modulation == MiesmTable::MODULATION_DEFAULT)
+        {
+          double checkError = table->GetMaxError ();
+          bool pass = errors.back () <= MiesmTable::MAX_ERROR
+              && checkError <= MiesmTable::MAX_ERROR;
+          cout << "MIESM_TABLE_CHECK DEFAULT measured_max_error_db " << errors.back ()
+               << " check_error_db " << checkError
+               << " bound_db " << MiesmTable::MAX_ERROR
+               << (pass ? " PASS" : " FAIL") << endl;
+          if (!pass)
+            {
+              exit (1);
+            }
+        }
+    }
+}
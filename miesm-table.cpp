@@ -0,0 +1,301 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "miesm-table.h"
+#include "miesm-effective-sinr.h"
+#include <math.h>
+#include <algorithm>
+#include <iostream>
+
+static const int NB_SINR_POINTS = 6001; // 0.01 dB
+static const int MI_LEVELS = 12; // 2^12 intervals on the MI grid
+
+MiesmTable* MiesmTable::ptr [MiesmTable::NB_MODULATIONS] = {};
+
+static bool useMiesmTable = false;
+
+void
+SetMiesmTable (bool enable)
+{
+  useMiesmTable = false;
+  if (!enable)
+    {
+      return;
+    }
+  double error = MiesmTable::Init ()->GetMaxError ();
+  if (error > MiesmTable::MAX_ERROR)
+    {
+      cout << "Warning: MIESM table error " << error
+           << " dB against GetMiesmEffectiveSinr, table disabled" << endl;
+      return;
+    }
+  useMiesmTable = true;
+}
+
+double
+ComputeMiesmEffectiveSinr (const vector<double>& sinr)
+{
+  if (useMiesmTable)
+    {
+      return MiesmTable::Init ()->GetEffectiveSinr (sinr);
+    }
+  return GetMiesmEffectiveSinr (sinr);
+}
+
+MiesmTable*
+MiesmTable::Init (Modulation m)
+{
+  if (ptr [m] == nullptr)
+    {
+      MiesmTable* table = new MiesmTable ();
+      if (m == MODULATION_DEFAULT)
+        {
+          table->BuildFromEffectiveSinr ();
+        }
+      else
+        {
+          table->BuildFromMmib (m);
+        }
+      ptr [m] = table;
+    }
+  return ptr [m];
+}
+
+MiesmTable::MiesmTable ()
+{
+  m_sinrStep = (MAX_SINR - MIN_SINR) / (NB_SINR_POINTS - 1);
+  m_minMutualInformation = 0;
+  m_mutualInformationStep = 0;
+}
+
+/*
+ * With I the (unknown) MI curve, GetMiesmEffectiveSinr ({a, b}) is the
+ * SINR whose MI is (I(a) + I(b)) / 2. Setting I(MIN_SINR) = 0 and
+ * I(MAX_SINR) = 1, repeated midpoints give the SINR of every MI value
+ * k / 2^MI_LEVELS; MIESM does not depend on the scale of I.
+ */
+void
+MiesmTable::BuildFromEffectiveSinr (void)
+{
+  int nbPoints = (1 << MI_LEVELS) + 1;
+  m_sinr.assign (nbPoints, 0);
+  m_sinr.front () = MIN_SINR;
+  m_sinr.back () = MAX_SINR;
+  vector<double> pair (2);
+  for (int width = nbPoints - 1; width > 1; width /= 2)
+    {
+      for (int left = 0; left + width < nbPoints; left += width)
+        {
+          pair.at (0) = m_sinr.at (left);
+          pair.at (1) = m_sinr.at (left + width);
+          m_sinr.at (left + width / 2) = GetMiesmEffectiveSinr (pair);
+        }
+    }
+  // guard against rounding in flat parts of the curve
+  for (int i = 1; i < nbPoints; i++)
+    {
+      m_sinr.at (i) = max (m_sinr.at (i), m_sinr.at (i - 1));
+    }
+  m_minMutualInformation = 0;
+  m_mutualInformationStep = 1. / (nbPoints - 1);
+  BuildForwardTable ();
+}
+
+void
+MiesmTable::BuildFromMmib (Modulation m)
+{
+  m_mutualInformation.resize (NB_SINR_POINTS);
+  for (int i = 0; i < NB_SINR_POINTS; i++)
+    {
+      m_mutualInformation.at (i) = GetMmibMutualInformation (m, MIN_SINR + i * m_sinrStep);
+    }
+
+  // invert the curve by bisection on the exact MMIB function
+  int nbPoints = (1 << MI_LEVELS) + 1;
+  m_minMutualInformation = m_mutualInformation.front ();
+  m_mutualInformationStep = (m_mutualInformation.back () - m_minMutualInformation) / (nbPoints - 1);
+  m_sinr.resize (nbPoints);
+  for (int k = 0; k < nbPoints; k++)
+    {
+      double target = m_minMutualInformation + k * m_mutualInformationStep;
+      double low = MIN_SINR;
+      double high = MAX_SINR;
+      for (int it = 0; it < 50; it++)
+        {
+          double mid = (low + high) / 2;
+          if (GetMmibMutualInformation (m, mid) < target)
+            {
+              low = mid;
+            }
+          else
+            {
+              high = mid;
+            }
+        }
+      // lowest SINR reaching the target, also where the curve saturates
+      m_sinr.at (k) = high;
+    }
+}
+
+// samples the inverse table on the uniform SINR grid
+void
+MiesmTable::BuildForwardTable (void)
+{
+  m_mutualInformation.resize (NB_SINR_POINTS);
+  int k = 0;
+  int last = m_sinr.size () - 1;
+  for (int i = 0; i < NB_SINR_POINTS; i++)
+    {
+      double sinr = MIN_SINR + i * m_sinrStep;
+      while (k < last - 1 && m_sinr.at (k + 1) <= sinr)
+        {
+          k++;
+        }
+      double span = m_sinr.at (k + 1) - m_sinr.at (k);
+      double w = span > 0 ? (sinr - m_sinr.at (k)) / span : 0;
+      w = min (max (w, 0.), 1.);
+      m_mutualInformation.at (i) = m_minMutualInformation + (k + w) * m_mutualInformationStep;
+    }
+}
+
+double
+MiesmTable::GetMutualInformation (double sinr)
+{
+  double position = (sinr - MIN_SINR) / m_sinrStep;
+  position = position < 0 ? 0 : position;
+  position = position > NB_SINR_POINTS - 1 ? NB_SINR_POINTS - 1 : position;
+  int i = min ((int) position, NB_SINR_POINTS - 2);
+  double w = position - i;
+  return m_mutualInformation [i] + w * (m_mutualInformation [i + 1] - m_mutualInformation [i]);
+}
+
+double
+MiesmTable::GetSinr (double mutualInformation)
+{
+  int nbPoints = m_sinr.size ();
+  double position = (mutualInformation - m_minMutualInformation) / m_mutualInformationStep;
+  position = position < 0 ? 0 : position;
+  position = position > nbPoints - 1 ? nbPoints - 1 : position;
+  int i = min ((int) position, nbPoints - 2);
+  double w = position - i;
+  return m_sinr [i] + w * (m_sinr [i + 1] - m_sinr [i]);
+}
+
+double
+MiesmTable::GetEffectiveSinr (const double* sinr, int n)
+{
+  if (n <= 0)
+    {
+      return MIN_SINR;
+    }
+  // the loop has no dependence between iterations but the sum, so the
+  // compiler can vectorize it (with gathers where available)
+  const double* table = m_mutualInformation.data ();
+  const double invStep = 1. / m_sinrStep;
+  const double maxPosition = NB_SINR_POINTS - 1.000001;
+  double sum = 0;
+  for (int j = 0; j < n; j++)
+    {
+      double position = (sinr [j] - MIN_SINR) * invStep;
+      position = position < 0 ? 0 : position;
+      position = position > maxPosition ? maxPosition : position;
+      int i = (int) position;
+      double w = position - i;
+      sum += table [i] + w * (table [i + 1] - table [i]);
+    }
+  return GetSinr (sum / n);
+}
+
+double
+MiesmTable::GetEffectiveSinr (const vector<double>& sinr)
+{
+  return GetEffectiveSinr (sinr.data (), sinr.size ());
+}
+
+/*
+ * Deterministic spans: 1 to 100 sub channels spread evenly over 0 to 20 dB
+ * around averages from -10 to 20 dB (the CQI range), compared with
+ * GetMiesmEffectiveSinr.
+ */
+double
+MiesmTable::GetMaxError (void)
+{
+  const int lengths [] = {1, 2, 6, 25, 100};
+  const double spreads [] = {0, 5, 10, 20};
+  double maxError = 0;
+  vector<double> span;
+  for (double average = -10; average <= 20; average += 2.5)
+    {
+      for (double spread : spreads)
+        {
+          for (int n : lengths)
+            {
+              span.resize (n);
+              for (int j = 0; j < n; j++)
+                {
+                  span.at (j) = (n == 1) ? average
+                      : average - spread / 2 + spread * j / (n - 1);
+                }
+              double error = fabs (GetEffectiveSinr (span) - GetMiesmEffectiveSinr (span));
+              maxError = max (maxError, error);
+            }
+        }
+    }
+  return maxError;
+}
+
+/*
+ * J function approximation (Brannstrom et al.) and MMIB mappings of the
+ * IEEE 802.16m evaluation methodology.
+ */
+static double
+J (double x)
+{
+  if (x > 10)
+    {
+      return 1; // the approximation is only meant for moderate x
+    }
+  if (x < 1.6363)
+    {
+      return -0.04210661 * x * x * x + 0.209252 * x * x - 0.00640081 * x;
+    }
+  return 1 - exp (0.00181492 * x * x * x - 0.142675 * x * x - 0.0822054 * x + 0.0549608);
+}
+
+double
+MiesmTable::GetMmibMutualInformation (Modulation m, double sinr)
+{
+  double s = sqrt (pow (10., sinr / 10.));
+  double mi;
+  switch (m)
+    {
+    case MODULATION_16QAM:
+      mi = 0.5 * J (0.8818 * s) + 0.25 * J (1.6764 * s) + 0.25 * J (0.9316 * s);
+      break;
+    case MODULATION_64QAM:
+      mi = (J (1.1233 * s) + J (0.4381 * s) + J (0.4765 * s)) / 3;
+      break;
+    case MODULATION_QPSK:
+    default:
+      mi = J (2 * s);
+      break;
+    }
+  return min (max (mi, 0.), 1.);
+}
@@ -0,0 +1,96 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MIESM_TABLE_H_
+#define MIESM_TABLE_H_
+
+#include <vector>
+
+/*
+ * Tabulated MIESM: the SINR -> mutual information curve is sampled on a
+ * uniform SINR grid and its inverse on a uniform MI grid, so that the
+ * effective SINR of a span of sub channels is one table interpolation per
+ * value plus one for the inversion.
+ *
+ * MODULATION_DEFAULT reproduces GetMiesmEffectiveSinr: its curve is
+ * recovered from GetMiesmEffectiveSinr itself, because the MIESM mean of
+ * two values always lies at the midpoint of their MI. The other tables
+ * use the MMIB approximations of QPSK, 16QAM and 64QAM.
+ * See miesm-table-report.h for the accuracy of the tables.
+ */
+class MiesmTable
+{
+public:
+  enum Modulation
+  {
+    MODULATION_DEFAULT,
+    MODULATION_QPSK,
+    MODULATION_16QAM,
+    MODULATION_64QAM,
+    NB_MODULATIONS
+  };
+
+  // tables are built on first use and never modified afterwards
+  static MiesmTable* Init (Modulation m = MODULATION_DEFAULT);
+
+  double GetEffectiveSinr (const double* sinr, int n); // dB
+  double GetEffectiveSinr (const std::vector<double>& sinr); // dB
+
+  double GetMutualInformation (double sinr); // sinr in dB
+  double GetSinr (double mutualInformation); // dB
+
+  // largest difference [dB] from GetMiesmEffectiveSinr on a fixed set of
+  // spans; only meaningful for MODULATION_DEFAULT
+  double GetMaxError (void);
+  static constexpr double MAX_ERROR = 0.1; // dB
+
+  // MMIB mutual information per bit, sinr in dB
+  static double GetMmibMutualInformation (Modulation m, double sinr);
+
+  static constexpr double MIN_SINR = -20; // dB
+  static constexpr double MAX_SINR = 40; // dB
+
+private:
+  MiesmTable ();
+  void BuildFromEffectiveSinr (void);
+  void BuildFromMmib (Modulation m);
+  void BuildForwardTable (void);
+
+  static MiesmTable* ptr [NB_MODULATIONS];
+
+  // mutual information on the uniform SINR grid
+  double m_sinrStep;
+  std::vector<double> m_mutualInformation;
+  // SINR on the uniform mutual information grid
+  double m_minMutualInformation;
+  double m_mutualInformationStep;
+  std::vector<double> m_sinr;
+};
+
+/*
+ * Effective SINR of the MIESM curve used by the simulator: through the
+ * MODULATION_DEFAULT table after SetMiesmTable (true), through
+ * GetMiesmEffectiveSinr otherwise (default). SetMiesmTable (true) keeps
+ * GetMiesmEffectiveSinr when the table is off by more than MAX_ERROR.
+ */
+void SetMiesmTable (bool enable);
+double ComputeMiesmEffectiveSinr (const std::vector<double>& sinr);
+
+#endif /* MIESM_TABLE_H_ */
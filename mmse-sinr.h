@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MMSE_SINR_H_
+#define MMSE_SINR_H_
+
+#include <complex>
+
+/*
+ * Post-MMSE SINR of every layer of a N_rx x N_layers channel (N <= 8),
+ * with fixed-size stack storage and no armadillo temporaries.
+ *
+ * With H the precoded channel (column major, N_rx x N_layers), the MMSE
+ * receiver is W = (H H^H + N I)^-1 H, obtained with a Cholesky solve.
+ * For C = W^H H:
+ *   SINR_k = |C_kk|^2 / (sum_{j != k} |C_kj|^2 + N (W^H W)_kk)
+ * SINRs are returned in linear units.
+ */
+
+static const int MMSE_SINR_MAX_ANTENNAS = 8;
+
+template <int NR, int NL>
+inline void
+MmseSinr (const std::complex<double>* h, double noise, double* sinr)
+{
+  typedef std::complex<double> cx;
+
+  // lower triangular Cholesky factor of H H^H + N I
+  cx l [NR][NR];
+  for (int j = 0; j < NR; j++)
+    {
+      for (int i = j; i < NR; i++)
+        {
+          cx a = (i == j) ? cx (noise, 0) : cx (0, 0);
+          for (int k = 0; k < NL; k++)
+            {
+              a += h [k * NR + i] * std::conj (h [k * NR + j]);
+            }
+          for (int k = 0; k < j; k++)
+            {
+              a -= l [i][k] * std::conj (l [j][k]);
+            }
+          if (i == j)
+            {
+              l [j][j] = cx (std::sqrt (a.real ()), 0);
+            }
+          else
+            {
+              l [i][j] = a / l [j][j].real ();
+            }
+        }
+    }
+
+  // W = L^-H L^-1 H, one column per layer
+  cx w [NL][NR];
+  for (int c = 0; c < NL; c++)
+    {
+      for (int i = 0; i < NR; i++)
+        {
+          cx y = h [c * NR + i];
+          for (int k = 0; k < i; k++)
+            {
+              y -= l [i][k] * w [c][k];
+            }
+          w [c][i] = y / l [i][i].real ();
+        }
+      for (int i = NR - 1; i >= 0; i--)
+        {
+          cx y = w [c][i];
+          for (int k = i + 1; k < NR; k++)
+            {
+              y -= std::conj (l [k][i]) * w [c][k];
+            }
+          w [c][i] = y / l [i][i].real ();
+        }
+    }
+
+  for (int k = 0; k < NL; k++)
+    {
+      double signal = 0;
+      double interference = 0;
+      for (int j = 0; j < NL; j++)
+        {
+          cx correlation (0, 0);
+          for (int r = 0; r < NR; r++)
+            {
+              correlation += std::conj (w [k][r]) * h [j * NR + r];
+            }
+          if (j == k)
+            {
+              signal = std::norm (correlation);
+            }
+          else
+            {
+              interference += std::norm (correlation);
+            }
+        }
+      double noiseGain = 0;
+      for (int r = 0; r < NR; r++)
+        {
+          noiseGain += std::norm (w [k][r]);
+        }
+      sinr [k] = signal / (interference + noise * noiseGain);
+    }
+}
+
+typedef void (*MmseSinrKernel) (const std::complex<double>* h, double noise, double* sinr);
+
+template <int NR>
+inline MmseSinrKernel
+GetMmseSinrKernel (int nbLayers)
+{
+  switch (nbLayers)
+    {
+    case 1: return &MmseSinr<NR, 1>;
+    case 2: return &MmseSinr<NR, 2>;
+    case 3: return &MmseSinr<NR, 3>;
+    case 4: return &MmseSinr<NR, 4>;
+    case 5: return &MmseSinr<NR, 5>;
+    case 6: return &MmseSinr<NR, 6>;
+    case 7: return &MmseSinr<NR, 7>;
+    case 8: return &MmseSinr<NR, 8>;
+    default: return nullptr;
+    }
+}
+
+inline MmseSinrKernel
+GetMmseSinrKernel (int nbRxAntennas, int nbLayers)
+{
+  switch (nbRxAntennas)
+    {
+    case 1: return GetMmseSinrKernel<1> (nbLayers);
+    case 2: return GetMmseSinrKernel<2> (nbLayers);
+    case 3: return GetMmseSinrKernel<3> (nbLayers);
+    case 4: return GetMmseSinrKernel<4> (nbLayers);
+    case 5: return GetMmseSinrKernel<5> (nbLayers);
+    case 6: return GetMmseSinrKernel<6> (nbLayers);
+    case 7: return GetMmseSinrKernel<7> (nbLayers);
+    case 8: return GetMmseSinrKernel<8> (nbLayers);
+    default: return nullptr;
+    }
+}
+
+/*
+ * SINRs of nbChannels channels stored one after the other (nbRxAntennas *
+ * nbLayers values each), e.g. all the sub channels of one reception.
+ * sinr receives nbLayers values per channel.
+ */
+inline void
+MmseSinrBatch (int nbRxAntennas, int nbLayers, int nbChannels,
+               const std::complex<double>* h, double noise, double* sinr)
+{
+  MmseSinrKernel kernel = GetMmseSinrKernel (nbRxAntennas, nbLayers);
+  int size = nbRxAntennas * nbLayers;
+  for (int i = 0; i < nbChannels; i++)
+    {
+      kernel (h + i * size, noise, sinr + i * nbLayers);
+    }
+}
+
+#endif /* MMSE_SINR_H_ */
@@ -0,0 +1,264 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nb-cell.h"
+#include "../utility/miesm-table.h"
+#include "../utility/trace-sink.h"
+#include "../phy/lte-phy.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+/*
+ * Runs many nbCell replications from one command.
+ * Usage: nbCellReplications <nbCell arguments 2..11> firstSeed
+ *                           replications workers [outputPrefix]
+ *
+ * Replication r runs nbCell with seed firstSeed + r. This is an interim
+ * driver: Simulator, FrameManager and NetworkManager are still
+ * process-wide singletons, so each replication runs in a child process
+ * forked by this driver, at most `workers` at a time, rather than on a
+ * thread of this process. Every child calls nbCell () with its own
+ * argument vector, so it parses argv and builds its scenario again; only
+ * the MIESM table is prepared once here and shared with the children
+ * through copy-on-write memory. The BLER table is left as nbCell leaves
+ * it, so a replication decodes exactly as a standalone nbCell run.
+ * Each child closes its trace sink before exiting and ends its output
+ * with a "REPLICATION_METRICS PHY_ERRORS <n>" line taken from the PHY
+ * error counter, so the error count does not depend on PHY tracing.
+ * The output of replication r goes to <outputPrefix>_<seed>.out (default
+ * prefix "nbCell"). Its metrics are reduced as soon as it completes, and
+ * the mean and standard deviation over all replications are printed at
+ * the end.
+ */
+
+struct NbCellReplicationMetrics
+{
+  int txPackets;
+  int rxPackets;
+  int phyErrors;
+  double delaySum;
+  double wallTime;
+};
+
+static bool
+ParseNbCellReplication (const std::string& fileName, NbCellReplicationMetrics& m)
+{
+  std::ifstream in (fileName.c_str ());
+  if (!in.is_open ())
+    {
+      return false;
+    }
+  m.txPackets = 0;
+  m.rxPackets = 0;
+  m.phyErrors = 0;
+  m.delaySum = 0;
+  bool hasMetrics = false;
+  std::string line;
+  while (getline (in, line))
+    {
+      if (line.compare (0, 7, "TX CBR ") == 0)
+        {
+          m.txPackets++;
+        }
+      else if (line.compare (0, 7, "RX CBR ") == 0)
+        {
+          m.rxPackets++;
+          size_t pos = line.rfind (" D ");
+          if (pos != std::string::npos)
+            {
+              m.delaySum += atof (line.c_str () + pos + 3);
+            }
+        }
+      else if (line.compare (0, 31, "REPLICATION_METRICS PHY_ERRORS ") == 0)
+        {
+          m.phyErrors = atoi (line.c_str () + 31);
+          hasMetrics = true;
+        }
+    }
+  return hasMetrics;
+}
+
+static void
+PrintNbCellReplicationSummary (const char* name, const std::vector<double>& values)
+{
+  double mean = 0;
+  for (double v : values)
+    {
+      mean += v;
+    }
+  mean /= values.size ();
+  double variance = 0;
+  for (double v : values)
+    {
+      variance += (v - mean) * (v - mean);
+    }
+  if (values.size () > 1)
+    {
+      variance /= values.size () - 1;
+    }
+  cout << "REPLICATIONS " << name
+       << " MEAN " << mean
+       << " STDDEV " << sqrt (variance)
+       << " N " << values.size () << endl;
+}
+
+static void
+nbCellReplications (int argc, char *argv[])
+{
+  if (argc < 15)
+    {
+      cout << "Usage: nbCellReplications schedType dur radius nbUE bandwidth carriers"
+           << " spacing tones CBR_interval CBR_size firstSeed replications workers"
+           << " [outputPrefix]" << endl;
+      return;
+    }
+  int firstSeed = atoi (argv[12]);
+  int replications = atoi (argv[13]);
+  int workers = atoi (argv[14]);
+  std::string prefix = (argc > 15) ? argv[15] : "nbCell";
+  if (workers < 1)
+    {
+      workers = 1;
+    }
+
+  // shared read-only data, built before forking
+  MiesmTable::Init ();
+
+  // nbCell arguments, argv[12] being the seed of the replication
+  std::vector<std::string> seeds (replications);
+  std::vector<char*> childArgv (argv, argv + 13);
+
+  typedef std::chrono::steady_clock Clock;
+  std::map<pid_t, int> running;
+  std::vector<Clock::time_point> startTimes (replications);
+  std::vector<double> delays, deliveryRatios, phyErrors, wallTimes;
+  int next = 0;
+  int failed = 0;
+
+  cout.flush ();
+  while (next < replications || !running.empty ())
+    {
+      while (next < replications && (int) running.size () < workers)
+        {
+          seeds [next] = std::to_string (firstSeed + next);
+          std::string fileName = prefix + "_" + seeds [next] + ".out";
+          startTimes [next] = Clock::now ();
+          pid_t pid = fork ();
+          if (pid == 0)
+            {
+              int fd = open (fileName.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+              if (fd < 0)
+                {
+                  _exit (1);
+                }
+              dup2 (fd, STDOUT_FILENO);
+              close (fd);
+              childArgv [12] = (char*) seeds [next].c_str ();
+              nbCell (13, childArgv.data ());
+              // _exit skips the static destructors: flush the trace here
+              TraceSink::Init ()->Close ();
+              cout << "REPLICATION_METRICS PHY_ERRORS "
+                   << LtePhy::GetNbPhyErrors () << endl;
+              cout.flush ();
+              _exit (0);
+            }
+          if (pid < 0)
+            {
+              cout << "Error in nbCellReplications: cannot fork replication "
+                   << firstSeed + next << endl;
+              failed++;
+            }
+          else
+            {
+              running [pid] = next;
+            }
+          next++;
+        }
+
+      if (running.empty ())
+        {
+          continue;
+        }
+      int status;
+      pid_t pid = wait (&status);
+      if (pid < 0 || running.find (pid) == running.end ())
+        {
+          continue;
+        }
+      int r = running [pid];
+      running.erase (pid);
+
+      NbCellReplicationMetrics m;
+      m.wallTime = std::chrono::duration<double> (Clock::now () - startTimes [r]).count ();
+      std::string fileName = prefix + "_" + seeds [r] + ".out";
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0
+          || !ParseNbCellReplication (fileName, m))
+        {
+          cout << "REPLICATION SEED " << seeds [r] << " FAILED" << endl;
+          failed++;
+          continue;
+        }
+
+      cout << "REPLICATION SEED " << seeds [r]
+           << " TX " << m.txPackets
+           << " RX " << m.rxPackets
+           << " PHY_ERRORS " << m.phyErrors
+           << " DELAY " << (m.rxPackets > 0 ? m.delaySum / m.rxPackets : 0)
+           << " WALL " << m.wallTime << endl;
+
+      if (m.rxPackets > 0)
+        {
+          delays.push_back (m.delaySum / m.rxPackets);
+        }
+      if (m.txPackets > 0)
+        {
+          deliveryRatios.push_back ((double) m.rxPackets / m.txPackets);
+        }
+      phyErrors.push_back (m.phyErrors);
+      wallTimes.push_back (m.wallTime);
+    }
+
+  if (!delays.empty ())
+    {
+      PrintNbCellReplicationSummary ("DELAY", delays);
+    }
+  if (!deliveryRatios.empty ())
+    {
+      PrintNbCellReplicationSummary ("DELIVERY_RATIO", deliveryRatios);
+    }
+  if (!wallTimes.empty ())
+    {
+      PrintNbCellReplicationSummary ("PHY_ERRORS", phyErrors);
+      PrintNbCellReplicationSummary ("WALL", wallTimes);
+    }
+  cout << "REPLICATIONS FAILED " << failed << endl;
+}
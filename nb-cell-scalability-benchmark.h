@@ -0,0 +1,225 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "nb-cell.h"
+#include "../core/eventScheduler/simulator.h"
+#include "../utility/perf-counters.h"
+#include "../utility/trace-sink.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+/*
+ * Scalability of the nbCell scenario.
+ * Usage: nbCellScalability schedType dur radius bandwidth spacing CBR_size
+ *                          seed ueCounts carriersList tonesList intervalList
+ *                          [csvFile]
+ * The lists are comma separated, e.g. "10,100,1000,10000,100000"; every
+ * combination is one point of the sweep.
+ *
+ * Each point runs nbCell in a child process (the simulator singletons
+ * cannot be reset in place) with every trace category disabled, so the
+ * scenario and PHY lines are not even formatted. Stdout is still sent to
+ * /dev/null for the lines printed by the applications and MAC, which
+ * have no trace category. Each point reports wall time, simulated
+ * seconds per wall second, peak RSS and heap allocations; allocations
+ * are -1 unless built with -DLTE_SIM_COUNT_ALLOCATIONS. Events per
+ * second are not reported: the Simulator does not count the events it
+ * dispatches. A summary table is printed at the end and the same rows
+ * are written to csvFile (default nbCellScalability.csv).
+ */
+
+struct NbCellScalabilityPoint
+{
+  int ues;
+  int carriers;
+  int tones;
+  int interval;
+  // measured in the child process
+  double wallTime; // s
+  double simulatedTime; // s
+  double peakRss; // kB
+  double allocations;
+  bool ok;
+};
+
+static vector<int>
+ParseNbCellScalabilityList (const char* list)
+{
+  vector<int> values;
+  string s (list);
+  size_t start = 0;
+  while (start <= s.size ())
+    {
+      size_t end = s.find (',', start);
+      if (end == string::npos)
+        {
+          end = s.size ();
+        }
+      if (end > start)
+        {
+          values.push_back (atoi (s.substr (start, end - start).c_str ()));
+        }
+      start = end + 1;
+    }
+  return values;
+}
+
+static void
+RunNbCellScalabilityPoint (int argc, char *argv[], NbCellScalabilityPoint& point)
+{
+  // nbCell arguments, see nb-cell.h
+  string args [13];
+  args [0] = argv[0];
+  args [1] = "nbCell";
+  args [2] = argv[2]; // schedType
+  args [3] = argv[3]; // dur
+  args [4] = argv[4]; // radius
+  args [5] = to_string (point.ues);
+  args [6] = argv[5]; // bandwidth
+  args [7] = to_string (point.carriers);
+  args [8] = argv[6]; // spacing
+  args [9] = to_string (point.tones);
+  args [10] = to_string (point.interval);
+  args [11] = argv[7]; // CBR_size
+  args [12] = argv[8]; // seed
+  char* childArgv [13];
+  for (int i = 0; i < 13; i++)
+    {
+      childArgv [i] = (char*) args [i].c_str ();
+    }
+
+  int fds [2];
+  point.ok = false;
+  if (pipe (fds) != 0)
+    {
+      return;
+    }
+  cout.flush ();
+  pid_t pid = fork ();
+  if (pid == 0)
+    {
+      close (fds [0]);
+      int devNull = open ("/dev/null", O_WRONLY);
+      dup2 (devNull, STDOUT_FILENO);
+      close (devNull);
+      TraceSink::Init ()->SetEnabled ("NONE");
+
+      long long allocationsAtStart = PerfCounters::GetAllocationCount ();
+      auto start = chrono::steady_clock::now ();
+      nbCell (13, childArgv);
+      cout.flush ();
+      point.wallTime = chrono::duration<double> (chrono::steady_clock::now () - start).count ();
+      point.simulatedTime = Simulator::Init ()->Now ();
+      point.peakRss = PerfCounters::GetPeakRss ();
+      long long allocations = PerfCounters::GetAllocationCount ();
+      point.allocations = (allocations < 0) ? -1 : allocations - allocationsAtStart;
+      point.ok = true;
+      bool written = write (fds [1], &point, sizeof (point)) == sizeof (point);
+      close (fds [1]);
+      _exit (written ? 0 : 1);
+    }
+  close (fds [1]);
+  if (pid > 0)
+    {
+      NbCellScalabilityPoint result;
+      if (read (fds [0], &result, sizeof (result)) == sizeof (result))
+        {
+          point = result;
+        }
+      int status;
+      waitpid (pid, &status, 0);
+      point.ok = point.ok && WIFEXITED (status) && WEXITSTATUS (status) == 0;
+    }
+  close (fds [0]);
+}
+
+static void nbCellScalabilityBenchmark (int argc, char *argv[])
+{
+  if (argc < 13)
+    {
+      cout << "Usage: nbCellScalability schedType dur radius bandwidth spacing CBR_size"
+           << " seed ueCounts carriersList tonesList intervalList [csvFile]" << endl;
+      return;
+    }
+  vector<int> ueCounts = ParseNbCellScalabilityList (argv[9]);
+  vector<int> carriersList = ParseNbCellScalabilityList (argv[10]);
+  vector<int> tonesList = ParseNbCellScalabilityList (argv[11]);
+  vector<int> intervalList = ParseNbCellScalabilityList (argv[12]);
+  string csvFile = (argc > 13) ? argv[13] : "nbCellScalability.csv";
+
+  vector<NbCellScalabilityPoint> points;
+  for (int ues : ueCounts)
+    {
+      for (int carriers : carriersList)
+        {
+          for (int tones : tonesList)
+            {
+              for (int interval : intervalList)
+                {
+                  NbCellScalabilityPoint point;
+                  point.ues = ues;
+                  point.carriers = carriers;
+                  point.tones = tones;
+                  point.interval = interval;
+                  RunNbCellScalabilityPoint (argc, argv, point);
+                  points.push_back (point);
+                  cout << "NBCELL_SCALABILITY point " << points.size () << " ues " << ues
+                       << " carriers " << carriers << " tones " << tones
+                       << " interval " << interval
+                       << (point.ok ? " done" : " FAILED") << endl;
+                }
+            }
+        }
+    }
+
+  ofstream csv (csvFile.c_str ());
+  csv << "ues,carriers,tones,interval,ok,wall_s,sim_s_per_wall_s,peak_rss_kb,allocations" << endl;
+  cout << setw (8) << "ues" << setw (10) << "carriers" << setw (7) << "tones"
+       << setw (10) << "interval" << setw (12) << "wall [s]" << setw (14) << "sim s/wall s"
+       << setw (14) << "peak RSS [kB]" << setw (14) << "allocations"
+       << endl;
+  for (auto& point : points)
+    {
+      double speed = (point.ok && point.wallTime > 0) ? point.simulatedTime / point.wallTime : -1;
+      csv << point.ues << "," << point.carriers << "," << point.tones << "," << point.interval
+          << "," << point.ok << "," << (point.ok ? point.wallTime : -1) << "," << speed
+          << "," << (point.ok ? point.peakRss : -1)
+          << "," << (point.ok ? point.allocations : -1) << endl;
+      cout << setw (8) << point.ues << setw (10) << point.carriers << setw (7) << point.tones
+           << setw (10) << point.interval;
+      if (!point.ok)
+        {
+          cout << "  FAILED" << endl;
+          continue;
+        }
+      cout << setw (12) << point.wallTime << setw (14) << speed
+           << setw (14) << point.peakRss << setw (14) << point.allocations << endl;
+    }
+  cout << "NBCELL_SCALABILITY csv " << csvFile << endl;
+}
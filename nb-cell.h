@@ -20,6 +20,9 @@
  * Author: Sergio Martiradonna <sergio.martiradonna@poliba.it>
  */
 
+#ifndef NB_CELL_H_
+#define NB_CELL_H_
+
 #include "../channel/LteChannel.h"
 #include "../phy/enb-lte-phy.h"
 #include "../phy/ue-lte-phy.h"
@@ -39,6 +42,9 @@
 #include "../flows/QoS/QoSForM_LWDF.h"
 #include "../componentManagers/FrameManager.h"
 #include "../utility/RandomVariable.h"
+#include "../utility/random-stream.h"
+#include "../utility/trace-sink.h"
+#include "../utility/event-profiler.h"
 #include "../channel/propagation-model/channel-realization.h"
 #include "../phy/wideband-cqi-eesm-error-model.h"
 #include "../phy/simple-error-model.h"
@@ -104,13 +110,17 @@ static void nbCell (int argc, char *argv[])
   if (seed >= 0)
     {
       srand (seed);
+      RandomStream::SetSeed (seed);
     }
   else
     {
       srand (time(NULL));
+      RandomStream::SetSeed (time(NULL));
     }
+TRACE_START(TRACE_SCENARIO)
   cout << "Simulation with SEED = " << seed << endl;
   cout << "Duration: " << duration << " flow: " << flow_duration << endl;
+TRACE_END
 
 
 
@@ -119,7 +129,8 @@ static void nbCell (int argc, char *argv[])
 
 
   //Define Application Container
-  CBR CBRApplication[nbUE];
+  // on the heap: a stack array overflows with a massive number of UEs
+  CBR* CBRApplication = new CBR [nbUE];
   int cbrApplication = 0;
   int destinationPort = 101;
   int applicationID = 0;
@@ -139,13 +150,14 @@ static void nbCell (int argc, char *argv[])
   spectrum->CreateNbIoTspectrum(carriers, spacing, tones);
 
 
-  cout << "TTI Length: ";
   frameManager->setTTILength(tones, spacing);
-  cout << frameManager->getTTILength() << "ms " << endl;
+TRACE_START(TRACE_SCENARIO)
+  cout << "TTI Length: " << frameManager->getTTILength() << "ms " << endl;
+TRACE_END
 
-DEBUG_LOG_START_1(LTE_SIM_SCHEDULER_DEBUG_NB)
+DEBUG_TRACE_START(DEBUG_SCHEDULER_NB)
   spectrum->Print();
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
 
   ENodeB::ULSchedulerType uplink_scheduler_type;
@@ -153,17 +165,24 @@ DEBUG_LOG_END
     {
     case 0:
       uplink_scheduler_type = ENodeB::ULScheduler_TYPE_NB_IOT_FIFO;
-      cout << "Scheduler NB FIFO "<< endl;
       break;
     case 1:
       uplink_scheduler_type = ENodeB::ULScheduler_TYPE_NB_IOT_ROUNDROBIN;
-      cout << "Scheduler NB RR "<< endl;
       break;
     default:
       uplink_scheduler_type = ENodeB::ULScheduler_TYPE_NB_IOT_FIFO;
-      cout << "Scheduler NB FIFO "<< endl;
       break;
     }
+TRACE_START(TRACE_SCENARIO)
+  if (uplink_scheduler_type == ENodeB::ULScheduler_TYPE_NB_IOT_ROUNDROBIN)
+    {
+      cout << "Scheduler NB RR "<< endl;
+    }
+  else
+    {
+      cout << "Scheduler NB FIFO "<< endl;
+    }
+TRACE_END
 
 
 
@@ -177,11 +196,19 @@ DEBUG_LOG_END
   WidebandCqiEesmErrorModel *errorModel = new WidebandCqiEesmErrorModel ();
   enb->GetPhy ()->SetErrorModel (errorModel);
 
+  // NB-IoT traffic is sparse and TTIs are long: sound the uplink of all
+  // UEs in one event per TTI instead of one event per UE per ms
+  EnbLtePhy* enbPhy = (EnbLtePhy*) enb->GetPhy ();
+  enbPhy->SetBatchedReferenceSymbols (true);
+  enbPhy->SetSoundingPerTti (true);
+
   ulCh->AddDevice (enb);
   enb->SetDLScheduler (ENodeB::DLScheduler_TYPE_PROPORTIONAL_FAIR);
   enb->SetULScheduler(uplink_scheduler_type);
   networkManager->GetENodeBContainer ()->push_back (enb);
+TRACE_START(TRACE_SCENARIO)
   cout << "Created eNB - id 1 position (0;0)"<< endl;
+TRACE_END
 
   //Create UEs
   int idUE = 2;
@@ -212,19 +239,24 @@ DEBUG_LOG_END
 
   for (int i = 0; i < nbUE; i++)
     {
-      zone = (rand() % static_cast<int>(nbOfZones));
-      cout << "ZONE " << zone;
+      // each UE draws from its own streams: its position and start time
+      // do not depend on the other UEs
+      RandomStream placement (idUE, RandomStream::RANDOM_PLACEMENT);
+      zone = placement.UniformInt (nbOfZones);
       low = edges[nbOfZones - 1 - zone];
-      cout << " LOW EDGE " << low;
-      random = ((double) rand()) / (double) RAND_MAX;
+      random = placement.Uniform ();
       random = random * zoneWidth;
       distance = random + (double) low;
+TRACE_START(TRACE_SCENARIO)
+      cout << "ZONE " << zone;
+      cout << " LOW EDGE " << low;
       cout << " DISTANCE " << distance;
       cout << endl;
+TRACE_END
 
-      sign = (rand() % 2) * 2 - 1;
+      sign = placement.UniformInt (2) * 2 - 1;
       posX=distance / sqrt(2) * sign;
-      sign = (rand() % 2) * 2 - 1;
+      sign = placement.UniformInt (2) * 2 - 1;
       posY=distance / sqrt(2) * sign;
       /*
        * double posX = 0;
@@ -244,7 +276,9 @@ DEBUG_LOG_END
                                              0, //handover false!
                                              Mobility::CONSTANT_POSITION);
 
+TRACE_START(TRACE_SCENARIO)
       cout << "Created UE - id " << idUE << " position " << posX << " " << posY << endl;
+TRACE_END
 
       ue->SetRandomAccessType(m_UeRandomAccessType);
       ue->GetPhy ()->SetDlChannel (dlCh);
@@ -260,7 +294,7 @@ DEBUG_LOG_END
       ChannelRealization* c_ul = new ChannelRealization (ue, enb, ChannelRealization::CHANNEL_MODEL_MACROCELL_URBAN);	// by zyb
       enb->GetPhy ()->GetUlChannel ()->GetPropagationLossModel ()->AddChannelRealization (c_ul);						// by zyb
 
-DEBUG_LOG_START_1(LTE_SIM_SCHEDULER_DEBUG_LOG)
+DEBUG_TRACE_START(DEBUG_SCHEDULER)
       CartesianCoordinates* userPosition = ue->GetMobilityModel()->GetAbsolutePosition();
       CartesianCoordinates* cellPosition = cell->GetCellCenterPosition();
       double distance = userPosition->GetDistance(cellPosition)/1000;
@@ -287,10 +321,11 @@ DEBUG_LOG_START_1(LTE_SIM_SCHEDULER_DEBUG_LOG)
            << " WIDTH " << zoneWidth
            << " ZONE " << zone
            << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
       //CREATE UPLINK APPLICATION FOR THIS UE
-      double start_time = 1 + (double)rand()/RAND_MAX * CBR_interval;
+      RandomStream startTime (idUE, RandomStream::RANDOM_APPLICATION);
+      double start_time = 1 + startTime.Uniform () * CBR_interval;
       //double start_time = CBR_interval;
       //double start_time = 1+  (rand() % static_cast<int>(CBR_interval));
       double duration_time = start_time + flow_duration;
@@ -321,7 +356,9 @@ DEBUG_LOG_END
                                                            TransportProtocol::TRANSPORT_PROTOCOL_TYPE_UDP);
       CBRApplication[cbrApplication].SetClassifierParameters (cp);
 
+TRACE_START(TRACE_SCENARIO)
       cout << "CREATED CBR APPLICATION, ID " << applicationID << endl;
+TRACE_END
 
       //update counter
       //destinationPort++;
@@ -332,4 +369,9 @@ DEBUG_LOG_END
 
   simulator->SetStop(duration);
   simulator->Run ();
+  EventProfiler::Init ()->Dump ();
+
+  delete [] CBRApplication;
 }
+
+#endif /* NB_CELL_H_ */
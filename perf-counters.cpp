@@ -0,0 +1,246 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "perf-counters.h"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#ifdef LTE_SIM_COUNT_ALLOCATIONS
+static std::atomic<long long> allocationCount (0);
+
+#ifdef __GLIBC__
+/*
+ * Counted at the malloc level, so that the blocks armadillo acquires
+ * with posix_memalign, and anything else not going through operator
+ * new, are seen too. The glibc entry points do the actual work.
+ */
+extern "C"
+{
+void* __libc_malloc (size_t size);
+void* __libc_calloc (size_t n, size_t size);
+void* __libc_realloc (void* p, size_t size);
+void* __libc_memalign (size_t alignment, size_t size);
+void __libc_free (void* p);
+
+void*
+malloc (size_t size)
+{
+  allocationCount.fetch_add (1, std::memory_order_relaxed);
+  return __libc_malloc (size);
+}
+
+void*
+calloc (size_t n, size_t size)
+{
+  allocationCount.fetch_add (1, std::memory_order_relaxed);
+  return __libc_calloc (n, size);
+}
+
+// counted as an allocation, since it may move the block
+void*
+realloc (void* p, size_t size)
+{
+  allocationCount.fetch_add (1, std::memory_order_relaxed);
+  return __libc_realloc (p, size);
+}
+
+void*
+memalign (size_t alignment, size_t size)
+{
+  allocationCount.fetch_add (1, std::memory_order_relaxed);
+  return __libc_memalign (alignment, size);
+}
+
+void*
+aligned_alloc (size_t alignment, size_t size)
+{
+  return memalign (alignment, size);
+}
+
+int
+posix_memalign (void** p, size_t alignment, size_t size)
+{
+  if (alignment % sizeof (void*) != 0 || (alignment & (alignment - 1)) != 0)
+    {
+      return EINVAL;
+    }
+  *p = memalign (alignment, size);
+  return (*p == nullptr && size != 0) ? ENOMEM : 0;
+}
+
+void
+free (void* p)
+{
+  __libc_free (p);
+}
+}
+#else
+/*
+ * Without glibc only operator new is counted: memory taken directly
+ * from malloc or posix_memalign (armadillo matrices) is not.
+ */
+void*
+operator new (std::size_t size)
+{
+  allocationCount.fetch_add (1, std::memory_order_relaxed);
+  void* p = malloc (size == 0 ? 1 : size);
+  if (p == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void*
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+void
+operator delete (void* p) noexcept
+{
+  free (p);
+}
+
+void
+operator delete[] (void* p) noexcept
+{
+  free (p);
+}
+
+void
+operator delete (void* p, std::size_t) noexcept
+{
+  free (p);
+}
+
+void
+operator delete[] (void* p, std::size_t) noexcept
+{
+  free (p);
+}
+#endif
+#endif
+
+PerfCounters::PerfCounters ()
+{
+  m_cacheMissesFd = -1;
+  m_cacheMisses = -1;
+  m_allocationsAtStart = -1;
+  m_allocations = -1;
+
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset (&attr, 0, sizeof (attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof (attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  m_cacheMissesFd = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+PerfCounters::~PerfCounters ()
+{
+  if (m_cacheMissesFd >= 0)
+    {
+      close (m_cacheMissesFd);
+    }
+}
+
+void
+PerfCounters::Start (void)
+{
+#ifdef __linux__
+  if (m_cacheMissesFd >= 0)
+    {
+      ioctl (m_cacheMissesFd, PERF_EVENT_IOC_RESET, 0);
+      ioctl (m_cacheMissesFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  m_allocationsAtStart = GetAllocationCount ();
+}
+
+void
+PerfCounters::Stop (void)
+{
+  long long allocations = GetAllocationCount ();
+  m_allocations = (allocations < 0) ? -1 : allocations - m_allocationsAtStart;
+
+  m_cacheMisses = -1;
+#ifdef __linux__
+  if (m_cacheMissesFd >= 0)
+    {
+      ioctl (m_cacheMissesFd, PERF_EVENT_IOC_DISABLE, 0);
+      long long count;
+      if (read (m_cacheMissesFd, &count, sizeof (count)) == sizeof (count))
+        {
+          m_cacheMisses = count;
+        }
+    }
+#endif
+}
+
+long long
+PerfCounters::GetCacheMisses (void)
+{
+  return m_cacheMisses;
+}
+
+long long
+PerfCounters::GetAllocations (void)
+{
+  return m_allocations;
+}
+
+long long
+PerfCounters::GetAllocationCount (void)
+{
+#ifdef LTE_SIM_COUNT_ALLOCATIONS
+  return allocationCount.load (std::memory_order_relaxed);
+#else
+  return -1;
+#endif
+}
+
+long
+PerfCounters::GetPeakRss (void)
+{
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+    {
+      return -1;
+    }
+  return usage.ru_maxrss;
+}
@@ -0,0 +1,59 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+/*
+ * Counters read around a measured section by the benchmarks.
+ *
+ * Cache misses come from the hardware counters of the calling thread
+ * (perf_event_open, Linux only). Heap allocations are counted when the
+ * simulator is built with -DLTE_SIM_COUNT_ALLOCATIONS, which replaces
+ * malloc and its aligned variants on glibc (so that the armadillo
+ * temporaries are counted too), and only the global operator new
+ * elsewhere. A counter that is not available reads -1.
+ */
+class PerfCounters
+{
+public:
+  PerfCounters ();
+  virtual ~PerfCounters ();
+
+  void Start (void);
+  void Stop (void);
+
+  // counts between the last Start () and Stop ()
+  long long GetCacheMisses (void);
+  long long GetAllocations (void);
+
+  // heap allocations since the start of the process
+  static long long GetAllocationCount (void);
+  // peak resident set size of the process [kB]
+  static long GetPeakRss (void);
+
+private:
+  int m_cacheMissesFd;
+  long long m_cacheMisses;
+  long long m_allocationsAtStart;
+  long long m_allocations;
+};
+
+#endif /* PERF_COUNTERS_H_ */
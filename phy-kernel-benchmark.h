@@ -0,0 +1,306 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../channel/LteChannel.h"
+#include "../phy/enb-lte-phy.h"
+#include "../phy/ue-lte-phy.h"
+#include "../phy/wideband-cqi-eesm-error-model.h"
+#include "../core/spectrum/bandwidth-manager.h"
+#include "../core/spectrum/transmitted-signal.h"
+#include "../core/idealMessages/ideal-control-messages.h"
+#include "../networkTopology/Cell.h"
+#include "../protocolStack/packet/packet-burst.h"
+#include "../protocolStack/mac/harq-manager.h"
+#include "../channel/propagation-model/channel-realization.h"
+#include "../channel/propagation-model/propagation-loss-model.h"
+#include "../device/UserEquipment.h"
+#include "../device/ENodeB.h"
+#include "../utility/trace-sink.h"
+#include "../utility/perf-counters.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <stdlib.h>
+
+/*
+ * Cost of the PHY building blocks, driven in isolation by one eNB and one
+ * UE with a macro cell urban channel realization.
+ * Usage: phyKernels [calls] [csvFile]
+ * Kernels: UeLtePhy::StartRx for TX modes 1, 2, 3, 4, 9 and 11 with
+ * 1/2/4/8 antennas (where the mode supports them), EnbLtePhy::StartRx,
+ * EnbLtePhy::ReceiveReferenceSymbols,
+ * WidebandCqiEesmErrorModel::CheckForPhysicalError and
+ * PropagationLossModel::AddLossModel, over 6 to 100 RBs.
+ * Writes one CSV row per kernel and configuration (to stdout, or to
+ * csvFile): ns/call, allocations/call and cache misses/call, the last two
+ * being -1 when not available (see PerfCounters).
+ */
+
+struct PhyKernelSetup
+{
+  ENodeB* enb;
+  UserEquipment* ue;
+  TransmittedSignal* ulSignal;
+  Cell* cell;
+  LteChannel* dlChannel;
+  LteChannel* ulChannel;
+  BandwidthManager* spectrum;
+  ChannelRealization* dlRealization;
+  ChannelRealization* ulRealization;
+  int antennas;
+  int rbs;
+};
+
+static PhyKernelSetup
+CreatePhyKernelSetup (int antennas, int rbs, int& nextId)
+{
+  double bandwidth;
+  switch (rbs)
+    {
+    case 6: bandwidth = 1.4; break;
+    case 15: bandwidth = 3; break;
+    case 25: bandwidth = 5; break;
+    case 50: bandwidth = 10; break;
+    case 75: bandwidth = 15; break;
+    default: bandwidth = 20; break;
+    }
+
+  Cell *cell = new Cell (0, 1, 0.005, 0, 0);
+  LteChannel *dlCh = new LteChannel ();
+  LteChannel *ulCh = new LteChannel ();
+  BandwidthManager* spectrum = new BandwidthManager (bandwidth, bandwidth, 0, 0);
+
+  PhyKernelSetup setup;
+  setup.antennas = antennas;
+  setup.rbs = rbs;
+  setup.cell = cell;
+  setup.dlChannel = dlCh;
+  setup.ulChannel = ulCh;
+  setup.spectrum = spectrum;
+
+  setup.enb = new ENodeB (nextId++, cell, 0, 0);
+  setup.enb->GetPhy ()->SetTxAntennas (antennas);
+  setup.enb->GetPhy ()->SetRxAntennas (antennas);
+  setup.enb->GetPhy ()->SetDlChannel (dlCh);
+  setup.enb->GetPhy ()->SetUlChannel (ulCh);
+  setup.enb->GetPhy ()->SetBandwidthManager (spectrum);
+  setup.enb->GetPhy ()->SetErrorModel (new WidebandCqiEesmErrorModel ());
+  setup.enb->SetDLScheduler (ENodeB::DLScheduler_TYPE_PROPORTIONAL_FAIR);
+
+  setup.ue = new UserEquipment (nextId++, 300, 200, 3, 0, cell, setup.enb,
+                                0, Mobility::CONSTANT_POSITION);
+  setup.ue->GetPhy ()->SetRxAntennas (antennas);
+  setup.ue->GetPhy ()->SetDlChannel (dlCh);
+  setup.ue->GetPhy ()->SetUlChannel (ulCh);
+  setup.ue->GetPhy ()->SetBandwidthManager (spectrum);
+  setup.ue->GetPhy ()->SetErrorModel (new WidebandCqiEesmErrorModel ());
+  setup.enb->RegisterUserEquipment (setup.ue);
+
+  setup.dlRealization = new ChannelRealization (setup.enb, setup.ue, ChannelRealization::CHANNEL_MODEL_MACROCELL_URBAN);
+  setup.ulRealization = new ChannelRealization (setup.ue, setup.enb, ChannelRealization::CHANNEL_MODEL_MACROCELL_URBAN);
+  dlCh->GetPropagationLossModel ()->AddChannelRealization (setup.dlRealization);
+  ulCh->GetPropagationLossModel ()->AddChannelRealization (setup.ulRealization);
+
+  // uplink transmission on every RB, as sent by a scheduled UE
+  double txPower = setup.ue->GetPhy ()->GetTxPower () - 30 - 10 * log10 (rbs); // dB per RB
+  vector< vector<double> > values (1, vector<double> (rbs, txPower));
+  setup.ulSignal = new TransmittedSignal ();
+  setup.ulSignal->SetValues (values);
+  return setup;
+}
+
+/*
+ * The phys delete their error models and signals, the channels their
+ * propagation loss models; the realizations, the spectrum and the cell
+ * are deleted here.
+ */
+static void
+DestroyPhyKernelSetup (PhyKernelSetup& setup)
+{
+  delete setup.ulSignal;
+  delete setup.ue;
+  delete setup.enb;
+  delete setup.dlRealization;
+  delete setup.ulRealization;
+  delete setup.dlChannel;
+  delete setup.ulChannel;
+  delete setup.spectrum;
+  delete setup.cell;
+}
+
+// every RB allocated to the UE in downlink
+static PdcchMapIdealControlMessage*
+CreatePhyKernelAllocation (PhyKernelSetup& setup)
+{
+  PdcchMapIdealControlMessage* map = new PdcchMapIdealControlMessage ();
+  for (int rb = 0; rb < setup.rbs; rb++)
+    {
+      map->AddNewRecord (PdcchMapIdealControlMessage::DOWNLINK, rb, setup.ue, 10);
+      auto& record = map->GetMessage ()->back ();
+      record.m_rank = 1;
+      record.m_pmi = vector<int> (1, 0);
+      record.m_assignedLayers = vector<int> (1, 0);
+      record.m_harqPid = HarqManager::HARQ_NOT_USED;
+    }
+  return map;
+}
+
+static void phyKernelBenchmark (int argc, char *argv[])
+{
+  int calls = 1000;
+  if (argc > 2)
+    {
+      calls = atoi(argv[2]);
+    }
+  ofstream file;
+  if (argc > 3)
+    {
+      file.open (argv[3]);
+    }
+  ostream& out = file.is_open () ? file : cout;
+
+  // the kernels must not print anything while they are measured
+  TraceSink::Init ()->SetEnabled ("NONE");
+
+  PerfCounters counters;
+  out << "kernel,tx_mode,antennas,rbs,calls,ns_per_call,allocs_per_call,cache_misses_per_call" << endl;
+
+  // prepare () runs before each call and finish () after it, neither is
+  // measured; finish () releases what the call returned
+  auto measure = [&] (const char* kernel, int txMode, PhyKernelSetup& setup,
+                      const function<void ()>& prepare, const function<void ()>& call,
+                      const function<void ()>& finish)
+    {
+      double ns = 0;
+      long long allocations = 0;
+      long long cacheMisses = 0;
+      for (int i = 0; i < calls; i++)
+        {
+          prepare ();
+          counters.Start ();
+          auto start = chrono::steady_clock::now ();
+          call ();
+          auto stop = chrono::steady_clock::now ();
+          counters.Stop ();
+          finish ();
+          ns += chrono::duration<double, nano> (stop - start).count ();
+          allocations = (counters.GetAllocations () < 0 || allocations < 0)
+              ? -1 : allocations + counters.GetAllocations ();
+          cacheMisses = (counters.GetCacheMisses () < 0 || cacheMisses < 0)
+              ? -1 : cacheMisses + counters.GetCacheMisses ();
+        }
+      out << kernel << "," << txMode << "," << setup.antennas << "," << setup.rbs
+          << "," << calls << "," << ns / calls
+          << "," << (allocations < 0 ? -1. : (double) allocations / calls)
+          << "," << (cacheMisses < 0 ? -1. : (double) cacheMisses / calls) << endl;
+    };
+
+  const int antennaCounts [] = {1, 2, 4, 8};
+  const int rbCounts [] = {6, 15, 25, 50, 75, 100};
+  const int txModes [] = {1, 2, 3, 4, 9, 11};
+  int nextId = 1;
+  shared_ptr<PacketBurst> p = make_shared<PacketBurst> ();
+
+  for (int rbs : rbCounts)
+    {
+      for (int antennas : antennaCounts)
+        {
+          PhyKernelSetup setup = CreatePhyKernelSetup (antennas, rbs, nextId);
+          EnbLtePhy* enbPhy = (EnbLtePhy*) setup.enb->GetPhy ();
+          UeLtePhy* uePhy = (UeLtePhy*) setup.ue->GetPhy ();
+          PropagationLossModel* dlLoss = enbPhy->GetDlChannel ()->GetPropagationLossModel ();
+          PropagationLossModel* ulLoss = enbPhy->GetUlChannel ()->GetPropagationLossModel ();
+          TransmittedSignal* rxSignal = nullptr;
+
+          measure ("AddLossModel", 0, setup,
+                   [&] () {},
+                   [&] () { rxSignal = dlLoss->AddLossModel (setup.enb, setup.ue, enbPhy->GetTxSignal ()); },
+                   [&] () { delete rxSignal; });
+
+          PdcchMapIdealControlMessage* map = CreatePhyKernelAllocation (setup);
+          vector<int> records;
+          for (int i = 0; i < (int) map->GetMessage ()->size (); i++)
+            {
+              records.push_back (i);
+            }
+          for (int txMode : txModes)
+            {
+              bool supported = (txMode == 1 || txMode == 11)
+                  || ((txMode == 2 || txMode == 3) && (antennas == 2 || antennas == 4))
+                  || ((txMode == 4 || txMode == 9) && antennas >= 2);
+              if (!supported)
+                {
+                  continue;
+                }
+              setup.ue->GetTargetNodeRecord ()->SetDlTxMode (txMode);
+              measure ("UeLtePhy::StartRx", txMode, setup,
+                       [&] ()
+                       {
+                         uePhy->ReceiveAllocationMap (map, records);
+                         rxSignal = dlLoss->AddLossModel (setup.enb, setup.ue, enbPhy->GetTxSignal ());
+                       },
+                       // StartRx deletes the signal
+                       [&] () { uePhy->StartRx (p, rxSignal); },
+                       [&] () {});
+            }
+          delete map;
+
+          // like the UE's sounding signal, ulSignal is the transmitted
+          // signal: ReceiveReferenceSymbols applies ulLoss->AddLossModel
+          // itself, so the measured cost includes it
+          measure ("EnbLtePhy::ReceiveReferenceSymbols", 0, setup,
+                   [&] () {},
+                   [&] () { enbPhy->ReceiveReferenceSymbols (setup.ue, setup.ulSignal); },
+                   [&] () {});
+
+          if (antennas == 1)
+            {
+              measure ("EnbLtePhy::StartRx", 0, setup,
+                       [&] ()
+                       {
+                         setup.ue->GetTargetNodeRecord ()->SetUlMcs (10);
+                         rxSignal = ulLoss->AddLossModel (setup.ue, setup.enb, setup.ulSignal);
+                       },
+                       // StartRx deletes the signal
+                       [&] () { enbPhy->StartRx (p, rxSignal, setup.ue); },
+                       [&] () {});
+
+              WidebandCqiEesmErrorModel errorModel;
+              vector<int> channels;
+              vector<double> sinr;
+              for (int rb = 0; rb < rbs; rb++)
+                {
+                  channels.push_back (rb);
+                  sinr.push_back (-5 + 20. * rb / rbs);
+                }
+              vector<int> cqi (1, 7);
+              measure ("WidebandCqiEesmErrorModel::CheckForPhysicalError", 0, setup,
+                       [&] () {},
+                       [&] () { errorModel.CheckForPhysicalError (channels, cqi, sinr); },
+                       [&] () {});
+            }
+
+          DestroyPhyKernelSetup (setup);
+        }
+    }
+}
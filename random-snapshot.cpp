@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "random-snapshot.h"
+#include "random-stream.h"
+#include "../componentManagers/NetworkManager.h"
+#include "../device/ENodeB.h"
+#include "../device/HeNodeB.h"
+#include "../device/UserEquipment.h"
+#include "../phy/lte-phy.h"
+#include <fstream>
+#include <vector>
+#include <cstring>
+
+static const char snapshotMagic [8] = {'R', 'N', 'D', 'S', 'N', 'A', 'P', '1'};
+
+// the streams of the snapshot, in file order, and the node that owns each
+// of them (-1 for the thread default stream)
+static void
+GetSnapshotStreams (std::vector<RandomStream*>& streams, std::vector<int>& nodes)
+{
+  NetworkManager* networkManager = NetworkManager::Init ();
+  streams.push_back (RandomStream::Current ());
+  nodes.push_back (-1);
+  for (auto enb : *networkManager->GetENodeBContainer ())
+    {
+      streams.push_back (enb->GetPhy ()->GetErrorStream ());
+      nodes.push_back (enb->GetIDNetworkNode ());
+    }
+  for (auto henb : *networkManager->GetHomeENodeBContainer ())
+    {
+      streams.push_back (henb->GetPhy ()->GetErrorStream ());
+      nodes.push_back (henb->GetIDNetworkNode ());
+    }
+  for (auto ue : *networkManager->GetUserEquipmentContainer ())
+    {
+      streams.push_back (ue->GetPhy ()->GetErrorStream ());
+      nodes.push_back (ue->GetIDNetworkNode ());
+    }
+}
+
+bool
+SaveRandomSnapshot (const char* fileName)
+{
+  std::vector<RandomStream*> streams;
+  std::vector<int> nodes;
+  GetSnapshotStreams (streams, nodes);
+
+  std::ofstream out (fileName, std::ios::binary);
+  if (!out)
+    {
+      return false;
+    }
+  uint64_t seed = RandomStream::GetSeed ();
+  uint32_t nbStreams = streams.size ();
+  out.write (snapshotMagic, sizeof (snapshotMagic));
+  out.write ((const char*) &seed, sizeof (seed));
+  out.write ((const char*) &nbStreams, sizeof (nbStreams));
+  for (uint32_t i = 0; i < nbStreams; i++)
+    {
+      int32_t node = nodes [i];
+      out.write ((const char*) &node, sizeof (node));
+      streams [i]->Write (out);
+    }
+  return (bool) out;
+}
+
+bool
+LoadRandomSnapshot (const char* fileName)
+{
+  std::vector<RandomStream*> streams;
+  std::vector<int> nodes;
+  GetSnapshotStreams (streams, nodes);
+
+  std::ifstream in (fileName, std::ios::binary);
+  if (!in)
+    {
+      return false;
+    }
+  char magic [sizeof (snapshotMagic)];
+  uint64_t seed;
+  uint32_t nbStreams;
+  in.read (magic, sizeof (magic));
+  in.read ((char*) &seed, sizeof (seed));
+  in.read ((char*) &nbStreams, sizeof (nbStreams));
+  if (!in || memcmp (magic, snapshotMagic, sizeof (magic)) != 0
+      || nbStreams != streams.size ())
+    {
+      return false;
+    }
+
+  // restored into copies first: nothing changes unless every record fits
+  uint64_t previousSeed = RandomStream::GetSeed ();
+  RandomStream::SetSeed (seed);
+  std::vector<RandomStream> restored;
+  restored.reserve (nbStreams);
+  for (uint32_t i = 0; i < nbStreams; i++)
+    {
+      int32_t node;
+      in.read ((char*) &node, sizeof (node));
+      restored.push_back (*streams [i]);
+      if (!in || node != nodes [i] || !restored.back ().Read (in))
+        {
+          RandomStream::SetSeed (previousSeed);
+          return false;
+        }
+    }
+  for (uint32_t i = 0; i < nbStreams; i++)
+    {
+      *streams [i] = restored [i];
+    }
+  return true;
+}
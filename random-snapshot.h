@@ -0,0 +1,43 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RANDOM_SNAPSHOT_H_
+#define RANDOM_SNAPSHOT_H_
+
+/*
+ * Snapshot of the RandomStream state of a simulation, in a binary file:
+ * the global seed, the default stream of the calling thread and the
+ * error stream of every eNB, home eNB and UE of the NetworkManager, in
+ * container order.
+ *
+ * This is the random part of a simulation snapshot only. The event
+ * queue, the nodes, the HARQ processes, the channel realizations, the
+ * applications and the rand () state of the C library are not saved, so
+ * a restored run only matches the saved one if everything else is
+ * rebuilt identically.
+ *
+ * LoadRandomSnapshot sets the saved seed and restores the streams into
+ * the nodes of the current scenario, which must have the same nodes in
+ * the same order. On any mismatch it returns false and changes nothing.
+ */
+bool SaveRandomSnapshot (const char* fileName);
+bool LoadRandomSnapshot (const char* fileName);
+
+#endif /* RANDOM_SNAPSHOT_H_ */
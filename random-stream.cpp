@@ -0,0 +1,237 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "random-stream.h"
+
+uint64_t RandomStream::m_seed = 0;
+
+static thread_local RandomStream* currentStream = nullptr;
+
+/*
+ * Philox4x32 with 10 rounds (Salmon et al., "Parallel random numbers:
+ * as easy as 1, 2, 3", SC'11). The counter is (block, entity, purpose),
+ * the key is the seed. Returns the 128 output bits as two 64 bit words.
+ */
+static inline void
+Philox (uint64_t seed, uint64_t block, uint32_t entity, uint32_t purpose,
+        uint64_t* out)
+{
+  uint32_t c0 = (uint32_t) block;
+  uint32_t c1 = (uint32_t) (block >> 32);
+  uint32_t c2 = entity;
+  uint32_t c3 = purpose;
+  uint32_t k0 = (uint32_t) seed;
+  uint32_t k1 = (uint32_t) (seed >> 32);
+
+  for (int round = 0; round < 10; round++)
+    {
+      uint64_t p0 = (uint64_t) 0xD2511F53 * c0;
+      uint64_t p1 = (uint64_t) 0xCD9E8D57 * c2;
+      uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+      uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+      c0 = n0;
+      c1 = (uint32_t) p1;
+      c2 = n2;
+      c3 = (uint32_t) p0;
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+
+  out [0] = ((uint64_t) c1 << 32) | c0;
+  out [1] = ((uint64_t) c3 << 32) | c2;
+}
+
+static inline double
+ToUniform (uint64_t bits)
+{
+  return (bits >> 11) * (1. / 9007199254740992.); // 2^-53
+}
+
+RandomStream::RandomStream ()
+{
+  SetKey (0, RANDOM_DEFAULT);
+}
+
+RandomStream::RandomStream (uint32_t entity, Purpose purpose)
+{
+  SetKey (entity, purpose);
+}
+
+void
+RandomStream::SetKey (uint32_t entity, Purpose purpose)
+{
+  m_entity = entity;
+  m_purpose = purpose;
+  m_counter = 0;
+  m_available = 0;
+}
+
+uint32_t
+RandomStream::GetEntity (void) const
+{
+  return m_entity;
+}
+
+RandomStream::Purpose
+RandomStream::GetPurpose (void) const
+{
+  return m_purpose;
+}
+
+uint64_t
+RandomStream::GetCounter (void) const
+{
+  return m_counter;
+}
+
+void
+RandomStream::SetCounter (uint64_t counter)
+{
+  m_counter = counter;
+  m_available = 0;
+}
+
+void
+RandomStream::Write (std::ostream& out) const
+{
+  uint32_t key [2] = { m_entity, (uint32_t) m_purpose };
+  int32_t available = m_available;
+  out.write ((const char*) &m_seed, sizeof (m_seed));
+  out.write ((const char*) key, sizeof (key));
+  out.write ((const char*) &m_counter, sizeof (m_counter));
+  out.write ((const char*) &available, sizeof (available));
+}
+
+bool
+RandomStream::Read (std::istream& in)
+{
+  uint64_t seed;
+  uint32_t key [2];
+  uint64_t counter;
+  int32_t available;
+  in.read ((char*) &seed, sizeof (seed));
+  in.read ((char*) key, sizeof (key));
+  in.read ((char*) &counter, sizeof (counter));
+  in.read ((char*) &available, sizeof (available));
+  // the buffered block is regenerated below with the current seed
+  if (!in || seed != m_seed || key [0] != m_entity || key [1] != (uint32_t) m_purpose
+      || available < 0 || available > 2 || (available > 0 && counter == 0))
+    {
+      return false;
+    }
+
+  // the buffered numbers are those of the last block drawn
+  m_counter = counter;
+  m_available = 0;
+  if (available > 0)
+    {
+      m_counter--;
+      NextBlock ();
+      m_available = available;
+    }
+  return true;
+}
+
+void
+RandomStream::NextBlock (void)
+{
+  Philox (m_seed, m_counter, m_entity, m_purpose, m_buffer);
+  m_counter++;
+  m_available = 2;
+}
+
+double
+RandomStream::Uniform (void)
+{
+  if (m_available == 0)
+    {
+      NextBlock ();
+    }
+  return ToUniform (m_buffer [2 - m_available--]);
+}
+
+int
+RandomStream::UniformInt (int n)
+{
+  return (int) (Uniform () * n);
+}
+
+void
+RandomStream::Fill (double* out, int n)
+{
+  int i = 0;
+  while (i < n && m_available > 0)
+    {
+      out [i++] = Uniform ();
+    }
+
+  // whole blocks: independent iterations, left to the vectorizer
+  int nbBlocks = (n - i) / 2;
+  uint64_t seed = m_seed;
+  uint64_t first = m_counter;
+  for (int b = 0; b < nbBlocks; b++)
+    {
+      uint64_t bits [2];
+      Philox (seed, first + b, m_entity, m_purpose, bits);
+      out [i + 2 * b] = ToUniform (bits [0]);
+      out [i + 2 * b + 1] = ToUniform (bits [1]);
+    }
+  m_counter += nbBlocks;
+  i += 2 * nbBlocks;
+
+  while (i < n)
+    {
+      out [i++] = Uniform ();
+    }
+}
+
+void
+RandomStream::SetSeed (uint64_t seed)
+{
+  m_seed = seed;
+}
+
+uint64_t
+RandomStream::GetSeed (void)
+{
+  return m_seed;
+}
+
+RandomStream::Scope::Scope (RandomStream* stream)
+{
+  m_previous = currentStream;
+  currentStream = stream;
+}
+
+RandomStream::Scope::~Scope ()
+{
+  currentStream = m_previous;
+}
+
+RandomStream*
+RandomStream::Current (void)
+{
+  if (currentStream != nullptr)
+    {
+      return currentStream;
+    }
+  static thread_local RandomStream defaultStream;
+  return &defaultStream;
+}
@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RANDOM_STREAM_H_
+#define RANDOM_STREAM_H_
+
+#include <cstdint>
+#include <iostream>
+
+/*
+ * Counter-based random numbers (Philox4x32-10).
+ *
+ * A stream is identified by (seed, entity, purpose) and only holds a
+ * counter: the n-th number of a stream is a pure function of these four
+ * values. Streams owned by different entities are therefore independent
+ * of each other and of the order in which they are used, which keeps
+ * results reproducible when entities are processed by several threads.
+ *
+ * The seed is global and read at draw time, so streams may be created
+ * before SetSeed () is called.
+ */
+class RandomStream
+{
+public:
+  enum Purpose
+  {
+    RANDOM_DEFAULT,
+    RANDOM_BLER,          // error model decisions
+    RANDOM_PLACEMENT,     // node positions
+    RANDOM_APPLICATION,   // application start times
+    RANDOM_CHANNEL        // channel realizations
+  };
+
+  RandomStream ();
+  RandomStream (uint32_t entity, Purpose purpose);
+
+  void SetKey (uint32_t entity, Purpose purpose);
+  uint32_t GetEntity (void) const;
+  Purpose GetPurpose (void) const;
+
+  // number of 128 bit blocks drawn so far
+  uint64_t GetCounter (void) const;
+  void SetCounter (uint64_t counter);
+
+  /*
+   * Binary state of the stream, for simulation snapshots: the seed, the
+   * key and the position, including a half consumed block. Read () fails,
+   * and leaves the stream unchanged, when the snapshot holds another key
+   * or was taken with another seed: call SetSeed () before restoring.
+   * See random-snapshot.h for the streams of a whole scenario.
+   */
+  void Write (std::ostream& out) const;
+  bool Read (std::istream& in);
+
+  // uniform in [0, 1), 53 bits of resolution
+  double Uniform (void);
+  // uniform integer in [0, n)
+  int UniformInt (int n);
+  // out[i] uniform in [0, 1): same values as n calls to Uniform ()
+  void Fill (double* out, int n);
+
+  static void SetSeed (uint64_t seed);
+  static uint64_t GetSeed (void);
+
+  // The stream returned by Current () while a Scope is alive in this
+  // thread. Lets a caller lend its own stream to code that cannot take it
+  // as an argument (e.g. ErrorModel::CheckForPhysicalError).
+  class Scope
+  {
+  public:
+    Scope (RandomStream* stream);
+    ~Scope ();
+  private:
+    RandomStream* m_previous;
+  };
+
+  // innermost scoped stream of this thread, or a per-thread
+  // RANDOM_DEFAULT stream of entity 0 when there is none
+  static RandomStream* Current (void);
+
+private:
+  void NextBlock (void);
+
+  uint32_t m_entity;
+  Purpose m_purpose;
+  uint64_t m_counter;
+  uint64_t m_buffer [2];
+  int m_available;
+
+  static uint64_t m_seed;
+};
+
+#endif /* RANDOM_STREAM_H_ */
@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <iostream>
+#include <stdlib.h>
+#include "rx-signal-buffer.h"
+#include "../core/spectrum/transmitted-signal.h"
+#include "../utility/db-conversion.h"
+
+RxSignalBuffer::RxSignalBuffer ()
+{
+  m_nbPaths = 0;
+  m_nbSubChannels = 0;
+  m_isMBSFNSignal = false;
+  m_linearValuesValid = false;
+}
+
+RxSignalBuffer::~RxSignalBuffer ()
+{
+}
+
+void
+RxSignalBuffer::Load (TransmittedSignal* s)
+{
+  const vector< vector<double> >& values = s->GetValues ();
+  const vector< vector<float> >& phases = s->GetPhases ();
+
+  m_nbPaths = values.size ();
+  m_nbSubChannels = (m_nbPaths > 0) ? values.at (0).size () : 0;
+  m_isMBSFNSignal = s->GetIsMBSFNSignal ();
+  m_linearValuesValid = false;
+
+  // resize () keeps the capacity reached by previous receptions
+  m_values.resize (m_nbPaths * m_nbSubChannels);
+  m_phases.resize (m_nbPaths * m_nbSubChannels);
+
+  for (int path = 0; path < m_nbPaths; path++)
+    {
+      const vector<double>& src = values.at (path);
+      if ((int) src.size () != m_nbSubChannels)
+        {
+          cout << "Error in RxSignalBuffer::Load: path " << path << " has "
+               << src.size () << " sub channels instead of " << m_nbSubChannels << endl;
+          exit (1);
+        }
+      copy (src.begin (), src.end (), m_values.data () + path * m_nbSubChannels);
+
+      // signals without phases, or with fewer paths of phases, get 0
+      float* dstPhases = m_phases.data () + path * m_nbSubChannels;
+      if (path < (int) phases.size () && (int) phases.at (path).size () == m_nbSubChannels)
+        {
+          copy (phases.at (path).begin (), phases.at (path).end (), dstPhases);
+        }
+      else
+        {
+          fill (dstPhases, dstPhases + m_nbSubChannels, 0.f);
+        }
+    }
+}
+
+void
+RxSignalBuffer::LoadFirstPath (TransmittedSignal* s)
+{
+  const vector< vector<double> >& values = s->GetValues ();
+
+  m_nbPaths = 1;
+  m_nbSubChannels = values.empty () ? 0 : values.at (0).size ();
+  m_isMBSFNSignal = s->GetIsMBSFNSignal ();
+  m_linearValuesValid = false;
+
+  if (m_nbSubChannels > 0)
+    {
+      m_values.assign (values.at (0).begin (), values.at (0).end ());
+    }
+  else
+    {
+      m_values.clear ();
+    }
+  m_phases.assign (m_nbSubChannels, 0.f);
+}
+
+const double*
+RxSignalBuffer::GetLinearValues (int path)
+{
+  if (!m_linearValuesValid)
+    {
+      m_linearValues.resize (m_values.size ());
+      DbToLinear (m_values.data (), m_linearValues.data (), m_values.size ());
+      m_linearValuesValid = true;
+    }
+  return m_linearValues.data () + path * m_nbSubChannels;
+}
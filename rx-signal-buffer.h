@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef RX_SIGNAL_BUFFER_H_
+#define RX_SIGNAL_BUFFER_H_
+
+#include <vector>
+
+class TransmittedSignal;
+
+/*
+ * Flat copy of a received signal, stored as contiguous [path][subchannel]
+ * arrays of powers (dB) and phases. Each PHY keeps one buffer and reloads
+ * it on every reception, so the buffer itself allocates nothing after the
+ * first TTI. Load binds the nested vectors of TransmittedSignal::GetValues
+ * and GetPhases to const references, so it copies them only once when
+ * the accessors return them by value. All the paths must have the same
+ * number of sub channels.
+ */
+class RxSignalBuffer
+{
+public:
+  RxSignalBuffer ();
+  virtual ~RxSignalBuffer ();
+
+  void Load (TransmittedSignal* s);
+  // powers of path 0 only, without phases: what the eNB receivers read
+  void LoadFirstPath (TransmittedSignal* s);
+
+  int GetNbPaths (void) const
+  {
+    return m_nbPaths;
+  }
+  int GetNbSubChannels (void) const
+  {
+    return m_nbSubChannels;
+  }
+  bool GetIsMBSFNSignal (void) const
+  {
+    return m_isMBSFNSignal;
+  }
+
+  double GetValue (int path, int subChannel) const
+  {
+    return m_values [path * m_nbSubChannels + subChannel];
+  }
+  float GetPhase (int path, int subChannel) const
+  {
+    return m_phases [path * m_nbSubChannels + subChannel];
+  }
+
+  // powers of all the sub channels of one path
+  const double* GetValues (int path) const
+  {
+    return m_values.data () + path * m_nbSubChannels;
+  }
+
+  // powers in linear units [W], converted for all the paths on first use
+  const double* GetLinearValues (int path);
+  double GetLinearValue (int path, int subChannel)
+  {
+    return GetLinearValues (path) [subChannel];
+  }
+
+private:
+  std::vector<double> m_values;
+  std::vector<double> m_linearValues;
+  bool m_linearValuesValid;
+  std::vector<float> m_phases;
+  int m_nbPaths;
+  int m_nbSubChannels;
+  bool m_isMBSFNSignal;
+};
+
+#endif /* RX_SIGNAL_BUFFER_H_ */
@@ -0,0 +1,712 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "trace-sink.h"
+#include <cstdlib>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*
+ * Binary trace layout: the 8 bytes magic "LTETRC01", then one record per
+ * trace call: [uint32 payload size][uint8 category][payload].
+ */
+static const char TRACE_MAGIC [8] = {'L', 'T', 'E', 'T', 'R', 'C', '0', '1'};
+static const int TRACE_RING_SIZE = 1 << 20;
+static const int TRACE_RECORD_HEADER = 5;
+
+struct PhyRxRecord
+{
+  int32_t src;
+  int32_t dst;
+  double x;
+  double y;
+  double sinr;
+  int32_t rb;
+  int32_t mcs;
+  int32_t size;
+  int32_t error;
+  double time;
+  int32_t coverShift;
+};
+
+struct UlDecodeRecord
+{
+  int32_t ue;
+  int32_t mcs;
+  int32_t dataToTranslate;
+};
+
+// followed by nbSinr doubles
+struct BlerDecisionRecord
+{
+  double effectiveSinr;
+  int32_t nbSinr;
+};
+
+struct PhyErrorRecord
+{
+  int32_t node;
+  int32_t error;
+};
+
+struct RachRecord
+{
+  int32_t subFrame;
+  int32_t window;
+  int32_t collisions;
+  int32_t total;
+};
+
+struct PmiSearchRecord
+{
+  int32_t ue;
+  int32_t layers;
+  int32_t subBand;
+  int32_t pmi;
+  int32_t exhaustivePmi;
+  double loss;
+};
+
+/*
+ * Single producer (the thread owning it) / single consumer (the writer
+ * thread) byte ring.
+ */
+struct TraceSink::Ring
+{
+  char buffer [TRACE_RING_SIZE];
+  std::atomic<size_t> head; // bytes written by the producer
+  std::atomic<size_t> tail; // bytes consumed by the writer
+
+  Ring ()
+  {
+    head = 0;
+    tail = 0;
+  }
+
+  void Push (const char* data, size_t size, size_t position)
+  {
+    size_t offset = position % TRACE_RING_SIZE;
+    size_t first = std::min (size, TRACE_RING_SIZE - offset);
+    memcpy (buffer + offset, data, first);
+    memcpy (buffer, data + first, size - first);
+  }
+};
+
+TraceSink* TraceSink::ptr = nullptr;
+
+// true when name is one of the items of the comma separated list
+static bool
+ListContains (const std::string& list, const std::string& name)
+{
+  size_t pos = list.find (name);
+  while (pos != std::string::npos)
+    {
+      size_t end = pos + name.size ();
+      if ((pos == 0 || list [pos - 1] == ',')
+          && (end == list.size () || list [end] == ','))
+        {
+          return true;
+        }
+      pos = list.find (name, pos + 1);
+    }
+  return false;
+}
+
+TraceSink::TraceSink ()
+{
+  m_binary = false;
+  m_textLineOpen = false;
+  m_file = -1;
+  m_writer = nullptr;
+  m_stop = false;
+  pthread_atfork (&TraceSink::PrepareFork, &TraceSink::ParentAfterFork,
+                  &TraceSink::ChildAfterFork);
+  for (int i = 0; i < NB_TRACE_CATEGORIES; i++)
+    {
+      m_enabled [i] = true;
+    }
+  for (int i = 0; i < NB_DEBUG_CATEGORIES; i++)
+    {
+      m_debugEnabled [i] = false;
+    }
+
+  const char* categories = std::getenv ("LTE_SIM_TRACE");
+  if (categories != nullptr)
+    {
+      SetEnabled (categories);
+    }
+  const char* debugCategories = std::getenv ("LTE_SIM_DEBUG");
+  if (debugCategories != nullptr)
+    {
+      SetDebugEnabled (debugCategories);
+    }
+  const char* fileName = std::getenv ("LTE_SIM_TRACE_FILE");
+  if (fileName != nullptr)
+    {
+      Open (fileName);
+    }
+}
+
+TraceSink::~TraceSink ()
+{
+  Close ();
+}
+
+TraceSink*
+TraceSink::Init (void)
+{
+  if (ptr == nullptr)
+    {
+      ptr = new TraceSink;
+      // flush the binary trace when the simulation exits
+      atexit ([] { ptr->Close (); });
+    }
+  return ptr;
+}
+
+const char*
+TraceSink::GetCategoryName (Category c)
+{
+  switch (c)
+    {
+    case TRACE_PHY_RX:
+      return "PHY_RX";
+    case TRACE_UL_DECODE:
+      return "UL_DECODE";
+    case TRACE_BLER_DECISION:
+      return "BLER";
+    case TRACE_PHY_ERROR:
+      return "PHY_ERROR";
+    case TRACE_RACH:
+      return "RACH";
+    case TRACE_PMI_SEARCH:
+      return "PMI_SEARCH";
+    case TRACE_SCENARIO:
+      return "SCENARIO";
+    default:
+      return "UNKNOWN";
+    }
+}
+
+void
+TraceSink::SetEnabled (Category c, bool enabled)
+{
+  m_enabled [c] = enabled;
+}
+
+void
+TraceSink::SetEnabled (const char* categories)
+{
+  std::string list (categories);
+  bool all = (list == "ALL");
+  for (int i = 0; i < NB_TRACE_CATEGORIES; i++)
+    {
+      m_enabled [i] = all || ListContains (list, GetCategoryName ((Category) i));
+    }
+}
+
+const char*
+TraceSink::GetDebugCategoryName (DebugCategory c)
+{
+  // the names of the compile time flags these categories replace
+  switch (c)
+    {
+    case DEBUG_DEVICE_ON_CHANNEL:
+      return "LTE_SIM_TEST_DEVICE_ON_CHANNEL";
+    case DEBUG_TRANSMISSION:
+      return "LTE_SIM_TRANSMISSION_DEBUG";
+    case DEBUG_UL_SINR:
+      return "LTE_SIM_TEST_UL_SINR";
+    case DEBUG_BLER:
+      return "LTE_SIM_BLER_DEBUG";
+    case DEBUG_HARQ:
+      return "LTE_SIM_HARQ_DEBUG";
+    case DEBUG_MCS:
+      return "LTE_SIM_MCS_DEBUG";
+    case DEBUG_MCS_OVERRIDING:
+      return "LTE_SIM_MCS_OVERRIDING_DEBUG";
+    case DEBUG_RANDOM_ACCESS:
+      return "LTE_SIM_RANDOM_ACCESS";
+    case DEBUG_SCHEDULER:
+      return "LTE_SIM_SCHEDULER_DEBUG_LOG";
+    case DEBUG_SCHEDULER_NB:
+      return "LTE_SIM_SCHEDULER_DEBUG_NB";
+    case DEBUG_CALIBRATION_STEP1:
+      return "CALIBRATION_STEP1";
+    default:
+      return "UNKNOWN";
+    }
+}
+
+void
+TraceSink::SetDebugEnabled (DebugCategory c, bool enabled)
+{
+  m_debugEnabled [c] = enabled;
+}
+
+void
+TraceSink::SetDebugEnabled (const char* categories)
+{
+  std::string list (categories);
+  bool all = (list == "ALL");
+  for (int i = 0; i < NB_DEBUG_CATEGORIES; i++)
+    {
+      m_debugEnabled [i] = all || ListContains (list, GetDebugCategoryName ((DebugCategory) i));
+    }
+}
+
+// writes all of data, false on an I/O error
+static bool
+WriteAll (int fd, const char* data, size_t size)
+{
+  while (size > 0)
+    {
+      ssize_t written = write (fd, data, size);
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          return false;
+        }
+      data += written;
+      size -= written;
+    }
+  return true;
+}
+
+/*
+ * The file is written with write (2), without a user space buffer, so that
+ * a forked child holds no copy of records the parent still has to write.
+ */
+bool
+TraceSink::Open (const char* fileName)
+{
+  Close ();
+  m_file = open (fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (m_file < 0 || !WriteAll (m_file, TRACE_MAGIC, sizeof (TRACE_MAGIC)))
+    {
+      std::cout << "Error in TraceSink::Open: cannot open " << fileName << std::endl;
+      if (m_file >= 0)
+        {
+          close (m_file);
+          m_file = -1;
+        }
+      return false;
+    }
+  m_stop = false;
+  m_binary = true;
+  m_writer = new std::thread (&TraceSink::WriterLoop, this);
+  return true;
+}
+
+void
+TraceSink::Close (void)
+{
+  if (m_textLineOpen)
+    {
+      std::cout << std::endl;
+      m_textLineOpen = false;
+    }
+  if (!m_binary)
+    {
+      return;
+    }
+  m_stop = true;
+  m_wakeWriter.notify_one ();
+  m_writer->join ();
+  delete m_writer;
+  m_writer = nullptr;
+  Drain ();
+  close (m_file);
+  m_file = -1;
+  m_binary = false;
+}
+
+/*
+ * fork () copies only the calling thread: the mutexes the writer may hold
+ * are taken around it, and the child, which has no writer, leaves the
+ * binary trace to its parent.
+ */
+void
+TraceSink::PrepareFork (void)
+{
+  ptr->m_ringsMutex.lock ();
+  ptr->m_waitMutex.lock ();
+}
+
+void
+TraceSink::ParentAfterFork (void)
+{
+  ptr->m_waitMutex.unlock ();
+  ptr->m_ringsMutex.unlock ();
+}
+
+void
+TraceSink::ChildAfterFork (void)
+{
+  ptr->m_waitMutex.unlock ();
+  ptr->m_ringsMutex.unlock ();
+  if (!ptr->m_binary)
+    {
+      return;
+    }
+  // the parent's thread object is left alone: its thread does not exist here
+  ptr->m_writer = nullptr;
+  close (ptr->m_file);
+  ptr->m_file = -1;
+  ptr->m_binary = false;
+  for (auto ring : ptr->m_rings)
+    {
+      ring->tail.store (ring->head.load ());
+    }
+}
+
+TraceSink::Ring*
+TraceSink::GetLocalRing (void)
+{
+  // rings live as long as the process: the writer may still drain one
+  // after its producer thread is gone
+  static thread_local Ring* ring = nullptr;
+  if (ring == nullptr)
+    {
+      ring = new Ring;
+      std::lock_guard<std::mutex> lock (m_ringsMutex);
+      m_rings.push_back (ring);
+    }
+  return ring;
+}
+
+void
+TraceSink::Write (Category c, const void* payload, int size,
+                  const void* extra, int extraSize)
+{
+  uint32_t payloadSize = size + extraSize;
+  char header [TRACE_RECORD_HEADER];
+  memcpy (header, &payloadSize, sizeof (uint32_t));
+  header [4] = (char) c;
+
+  if (!m_binary)
+    {
+      const char* record = (const char*) payload;
+      if (extraSize > 0)
+        {
+          // reused by all the records of the thread
+          static thread_local std::vector<char> buffer;
+          buffer.resize (payloadSize);
+          memcpy (buffer.data (), payload, size);
+          memcpy (buffer.data () + size, extra, extraSize);
+          record = buffer.data ();
+        }
+      PrintRecord (c, record, payloadSize, std::cout, m_textLineOpen);
+      if (m_textLineOpen && !m_enabled [TRACE_BLER_DECISION])
+        {
+          std::cout << std::endl;
+          m_textLineOpen = false;
+        }
+      return;
+    }
+
+  Ring* ring = GetLocalRing ();
+  size_t recordSize = TRACE_RECORD_HEADER + payloadSize;
+  size_t head = ring->head.load (std::memory_order_relaxed);
+  // never drop a record: wait for the writer when the ring is full
+  auto fits = [&] ()
+    {
+      return head + recordSize - ring->tail.load (std::memory_order_acquire) <= TRACE_RING_SIZE;
+    };
+  if (!fits ())
+    {
+      std::unique_lock<std::mutex> lock (m_waitMutex);
+      m_wakeWriter.notify_one ();
+      m_drained.wait (lock, fits);
+    }
+  ring->Push (header, TRACE_RECORD_HEADER, head);
+  ring->Push ((const char*) payload, size, head + TRACE_RECORD_HEADER);
+  if (extraSize > 0)
+    {
+      ring->Push ((const char*) extra, extraSize, head + TRACE_RECORD_HEADER + size);
+    }
+  ring->head.store (head + recordSize, std::memory_order_release);
+}
+
+bool
+TraceSink::Drain (void)
+{
+  std::vector<Ring*> rings;
+    {
+      std::lock_guard<std::mutex> lock (m_ringsMutex);
+      rings = m_rings;
+    }
+
+  bool written = false;
+  for (auto ring : rings)
+    {
+      size_t tail = ring->tail.load (std::memory_order_relaxed);
+      size_t head = ring->head.load (std::memory_order_acquire);
+      if (head == tail)
+        {
+          continue;
+        }
+      size_t offset = tail % TRACE_RING_SIZE;
+      size_t size = head - tail;
+      size_t first = std::min (size, TRACE_RING_SIZE - offset);
+      if (!WriteAll (m_file, ring->buffer + offset, first)
+          || !WriteAll (m_file, ring->buffer, size - first))
+        {
+          std::cout << "Error in TraceSink::Drain: cannot write the trace file" << std::endl;
+          exit (1);
+        }
+      ring->tail.store (head, std::memory_order_release);
+      written = true;
+    }
+  return written;
+}
+
+void
+TraceSink::WriterLoop (void)
+{
+  while (!m_stop)
+    {
+      bool written = Drain ();
+      std::unique_lock<std::mutex> lock (m_waitMutex);
+      if (written)
+        {
+          m_drained.notify_all ();
+        }
+      else if (!m_stop)
+        {
+          m_wakeWriter.wait_for (lock, std::chrono::milliseconds (1));
+        }
+    }
+}
+
+void
+TraceSink::TracePhyRx (int src, int dst, double x, double y, double sinr, int rb,
+                       int mcs, int size, bool error, double time, int coverShift)
+{
+  PhyRxRecord r = {src, dst, x, y, sinr, rb, mcs, size, error, time, coverShift};
+  Write (TRACE_PHY_RX, &r, sizeof (r));
+}
+
+void
+TraceSink::TraceUlDecode (int ue, int mcs, int dataToTranslate)
+{
+  UlDecodeRecord r = {ue, mcs, dataToTranslate};
+  Write (TRACE_UL_DECODE, &r, sizeof (r));
+}
+
+void
+TraceSink::TraceBlerDecision (const std::vector<double>& sinr, double effectiveSinr)
+{
+  BlerDecisionRecord r = {effectiveSinr, (int32_t) sinr.size ()};
+  Write (TRACE_BLER_DECISION, &r, sizeof (r), sinr.data (), sinr.size () * sizeof (double));
+}
+
+void
+TraceSink::TracePhyError (int node, bool error)
+{
+  PhyErrorRecord r = {node, error};
+  Write (TRACE_PHY_ERROR, &r, sizeof (r));
+}
+
+void
+TraceSink::TraceRach (int subFrame, int window, int collisions, int total)
+{
+  RachRecord r = {subFrame, window, collisions, total};
+  Write (TRACE_RACH, &r, sizeof (r));
+}
+
+void
+TraceSink::TracePmiSearch (int ue, int layers, int subBand, int pmi, int exhaustivePmi,
+                           double loss)
+{
+  PmiSearchRecord r = {ue, layers, subBand, pmi, exhaustivePmi, loss};
+  Write (TRACE_PMI_SEARCH, &r, sizeof (r));
+}
+
+/*
+ * Returns false, printing nothing, when size does not match the payload
+ * expected for the category.
+ */
+bool
+TraceSink::PrintRecord (Category c, const char* payload, int size,
+                        std::ostream& out, bool& lineOpen)
+{
+  // an UL_DECODE line not followed by its BLER decision is ended here
+  if (lineOpen && c != TRACE_BLER_DECISION)
+    {
+      out << std::endl;
+    }
+  lineOpen = (c == TRACE_UL_DECODE);
+  switch (c)
+    {
+    case TRACE_PHY_RX:
+      {
+        PhyRxRecord r;
+        if (size != (int) sizeof (r))
+          {
+            return false;
+          }
+        memcpy (&r, payload, sizeof (r));
+        out << "PHY_RX SRC " << r.src
+            << " DST " << r.dst << " X " << r.x << " Y " << r.y
+            << " SINR " << r.sinr << " RB " << r.rb
+            << " MCS " << r.mcs << " SIZE " << r.size << " ERR "
+            << r.error << " T " << r.time;
+        if (r.coverShift >= 0)
+          {
+            out << " CS " << r.coverShift;
+          }
+        out << std::endl;
+        break;
+      }
+    case TRACE_UL_DECODE:
+      {
+        // the line is completed by the BLER decision of the same packet
+        UlDecodeRecord r;
+        if (size != (int) sizeof (r))
+          {
+            return false;
+          }
+        memcpy (&r, payload, sizeof (r));
+        out << "\t UE " << r.ue << " mcs " << r.mcs
+            << " data to translate: " << r.dataToTranslate << " sinr ";
+        break;
+      }
+    case TRACE_BLER_DECISION:
+      {
+        BlerDecisionRecord r;
+        if (size < (int) sizeof (r))
+          {
+            return false;
+          }
+        memcpy (&r, payload, sizeof (r));
+        if (r.nbSinr < 0
+            || (size_t) size != sizeof (r) + (size_t) r.nbSinr * sizeof (double))
+          {
+            return false;
+          }
+        for (int i = 0; i < r.nbSinr; i++)
+          {
+            double sinr;
+            memcpy (&sinr, payload + sizeof (r) + i * sizeof (double), sizeof (double));
+            out << sinr << " ";
+          }
+        out << "effective_sinr " << r.effectiveSinr << std::endl;
+        break;
+      }
+    case TRACE_PHY_ERROR:
+      {
+        PhyErrorRecord r;
+        if (size != (int) sizeof (r))
+          {
+            return false;
+          }
+        memcpy (&r, payload, sizeof (r));
+        out << "**** " << (r.error ? "YES" : "NO")
+            << " PHY ERROR (node " << r.node << ") ****" << std::endl;
+        break;
+      }
+    case TRACE_RACH:
+      {
+        RachRecord r;
+        if (size != (int) sizeof (r))
+          {
+            return false;
+          }
+        memcpy (&r, payload, sizeof (r));
+        out << "RACH INFO SF " << r.subFrame << " WIN " << r.window
+            << " COLLISIONS " << r.collisions << " TOT " << r.total << std::endl;
+        break;
+      }
+    case TRACE_PMI_SEARCH:
+      {
+        PmiSearchRecord r;
+        if (size != (int) sizeof (r))
+          {
+            return false;
+          }
+        memcpy (&r, payload, sizeof (r));
+        out << "PMI_SEARCH UE " << r.ue
+            << " LAYERS " << r.layers << " SUBBAND " << r.subBand
+            << " PMI " << r.pmi << " EXHAUSTIVE "
+            << r.exhaustivePmi << " LOSS " << r.loss << std::endl;
+        break;
+      }
+    default:
+      return false;
+    }
+  return true;
+}
+
+bool
+TraceSink::ConvertToText (const char* fileName, std::ostream& out)
+{
+  std::ifstream in (fileName, std::ios::binary);
+  char magic [sizeof (TRACE_MAGIC)];
+  if (!in.read (magic, sizeof (magic))
+      || memcmp (magic, TRACE_MAGIC, sizeof (TRACE_MAGIC)) != 0)
+    {
+      std::cout << "Error in TraceSink::ConvertToText: " << fileName
+                << " is not a trace file" << std::endl;
+      return false;
+    }
+
+  std::string payload;
+  bool lineOpen = false;
+  char header [TRACE_RECORD_HEADER];
+  while (in.read (header, TRACE_RECORD_HEADER))
+    {
+      uint32_t size;
+      memcpy (&size, header, sizeof (uint32_t));
+      // Write () never produces a record larger than a ring
+      if (size > TRACE_RING_SIZE - TRACE_RECORD_HEADER)
+        {
+          std::cout << "Error in TraceSink::ConvertToText: corrupt record" << std::endl;
+          return false;
+        }
+      payload.resize (size);
+      if (!in.read (&payload [0], size))
+        {
+          std::cout << "Error in TraceSink::ConvertToText: truncated record" << std::endl;
+          return false;
+        }
+      if (!PrintRecord ((Category) header [4], payload.data (), size, out, lineOpen))
+        {
+          std::cout << "Error in TraceSink::ConvertToText: corrupt "
+                    << GetCategoryName ((Category) header [4]) << " record" << std::endl;
+          return false;
+        }
+    }
+  if (lineOpen)
+    {
+      out << std::endl;
+    }
+  return true;
+}
@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef TRACE_SINK_H_
+#define TRACE_SINK_H_
+
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/*
+ * Typed simulation traces (PHY_RX, UL decode, BLER decision, RACH, PMI
+ * search...).
+ *
+ * Every category can be enabled or disabled at run time, from code or
+ * with the LTE_SIM_TRACE environment variable (comma separated list of
+ * category names, or "NONE").
+ * The SCENARIO category gates the set-up lines printed by the scenarios
+ * (created nodes and applications); it has no binary record.
+ * Records are printed to stdout in the historical text format, unless a
+ * binary trace file is opened (Open () or LTE_SIM_TRACE_FILE): records are
+ * then appended to a lock-free per-thread ring buffer and written to the
+ * file by a background thread; a thread whose ring is full waits for the
+ * writer. ConvertToText () turns a binary trace back into the text format.
+ * A process forked while the binary trace is open does not inherit it: the
+ * child drops the records the parent had not written yet and prints its
+ * own records as text, until it opens a file of its own.
+ *
+ * The free text debugging output that used to be switched at compile
+ * time (DEBUG_LOG_START_1 and the LTE_SIM_* flags of load-parameters.h)
+ * goes through debug categories instead. They are all disabled by
+ * default and are enabled with SetDebugEnabled () or the LTE_SIM_DEBUG
+ * environment variable (comma separated flag names, or "ALL"). Their
+ * lines always go to stdout, also when a binary trace file is open.
+ */
+class TraceSink
+{
+public:
+  enum Category
+  {
+    TRACE_PHY_RX,
+    TRACE_UL_DECODE,
+    TRACE_BLER_DECISION,
+    TRACE_PHY_ERROR,
+    TRACE_RACH,
+    TRACE_PMI_SEARCH,
+    TRACE_SCENARIO, // scenario set-up lines, stdout only
+    NB_TRACE_CATEGORIES
+  };
+
+  enum DebugCategory
+  {
+    DEBUG_DEVICE_ON_CHANNEL,
+    DEBUG_TRANSMISSION,
+    DEBUG_UL_SINR,
+    DEBUG_BLER,
+    DEBUG_HARQ,
+    DEBUG_MCS,
+    DEBUG_MCS_OVERRIDING,
+    DEBUG_RANDOM_ACCESS,
+    DEBUG_SCHEDULER,
+    DEBUG_SCHEDULER_NB,
+    DEBUG_CALIBRATION_STEP1,
+    NB_DEBUG_CATEGORIES
+  };
+
+  static TraceSink* Init (void);
+
+  bool IsEnabled (Category c)
+  {
+    return m_enabled [c];
+  }
+  void SetEnabled (Category c, bool enabled);
+  void SetEnabled (const char* categories);
+  static const char* GetCategoryName (Category c);
+
+  bool IsDebugEnabled (DebugCategory c)
+  {
+    return m_debugEnabled [c];
+  }
+  void SetDebugEnabled (DebugCategory c, bool enabled);
+  void SetDebugEnabled (const char* categories);
+  static const char* GetDebugCategoryName (DebugCategory c);
+
+  bool Open (const char* fileName);
+  void Close (void);
+
+  void TracePhyRx (int src, int dst, double x, double y, double sinr, int rb,
+                   int mcs, int size, bool error, double time, int coverShift = -1);
+  void TraceUlDecode (int ue, int mcs, int dataToTranslate);
+  void TraceBlerDecision (const std::vector<double>& sinr, double effectiveSinr);
+  void TracePhyError (int node, bool error);
+  void TraceRach (int subFrame, int window, int collisions, int total);
+  void TracePmiSearch (int ue, int layers, int subBand, int pmi, int exhaustivePmi,
+                       double loss);
+
+  static bool ConvertToText (const char* fileName, std::ostream& out);
+
+private:
+  TraceSink ();
+  virtual ~TraceSink ();
+
+  struct Ring;
+  Ring* GetLocalRing (void);
+  void Write (Category c, const void* payload, int size,
+              const void* extra = nullptr, int extraSize = 0);
+  void WriterLoop (void);
+  bool Drain (void);
+  static bool PrintRecord (Category c, const char* payload, int size,
+                           std::ostream& out, bool& lineOpen);
+  static void PrepareFork (void);
+  static void ParentAfterFork (void);
+  static void ChildAfterFork (void);
+
+  static TraceSink* ptr;
+
+  bool m_enabled [NB_TRACE_CATEGORIES];
+  bool m_debugEnabled [NB_DEBUG_CATEGORIES];
+  bool m_binary;
+  bool m_textLineOpen; // an UL_DECODE line waits for its BLER decision
+  int m_file;
+  std::thread* m_writer;
+  std::atomic<bool> m_stop;
+  std::mutex m_ringsMutex;
+  std::vector<Ring*> m_rings;
+  // a producer with a full ring waits on m_drained, the writer on m_wakeWriter
+  std::mutex m_waitMutex;
+  std::condition_variable m_drained;
+  std::condition_variable m_wakeWriter;
+};
+
+#define TRACE_START(c) \
+  if (TraceSink::Init ()->IsEnabled (TraceSink::c)) {
+#define TRACE_END }
+#define DEBUG_TRACE_START(c) \
+  if (TraceSink::Init ()->IsDebugEnabled (TraceSink::c)) {
+#define DEBUG_TRACE_START_2(c1,c2) \
+  if (TraceSink::Init ()->IsDebugEnabled (TraceSink::c1) \
+      || TraceSink::Init ()->IsDebugEnabled (TraceSink::c2)) {
+#define DEBUG_TRACE_END }
+
+#endif /* TRACE_SINK_H_ */
@@ -0,0 +1,42 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../utility/trace-sink.h"
+
+#include <iostream>
+#include <stdlib.h>
+
+/*
+ * Converts a binary trace written with LTE_SIM_TRACE_FILE back into the
+ * text printed by a run without it.
+ * Usage: traceToText <trace file>
+ */
+static void traceToText (int argc, char *argv[])
+{
+  if (argc < 3)
+    {
+      cout << "Usage: traceToText <trace file>" << endl;
+      exit (1);
+    }
+  if (!TraceSink::ConvertToText (argv[2], cout))
+    {
+      exit (1);
+    }
+}
@@ -40,13 +40,19 @@
 #include "../protocolStack/mac/ue-mac-entity.h"
 #include "../utility/eesm-effective-sinr.h"
 #include "../utility/miesm-effective-sinr.h"
+#include "../utility/miesm-table.h"
 #include "enb-lte-phy.h"
 #include "../utility/ComputePathLoss.h"
 #include "../utility/mimo-codebook.h"
+#include "../utility/codebook-store.h"
 #include "sinr-calculator.h"
+#include "mmse-sinr.h"
 #include "precoding-calculator.h"
-#include "../componentManagers/FrameManager.h"
+#include "../componentManagers/frame-context.h"
 #include "../protocolStack/mac/harq-manager.h"
+#include "../utility/db-conversion.h"
+#include "../utility/trace-sink.h"
+#include "../utility/event-profiler.h"
 
 UeLtePhy::UeLtePhy() {
 	m_channelsForRx.clear();
@@ -55,7 +61,8 @@ UeLtePhy::UeLtePhy() {
 	m_mcsIndexForTx.clear();
 	m_pmiForRx.clear();
 	m_rankForRx = 0;
-	m_precodingMatricesForRx.clear();
+	m_pmiSearch = PMI_SEARCH_EXHAUSTIVE;
+	m_pmiSearchCheck = false;
 	SetDevice(nullptr);
 	SetDlChannel(nullptr);
 	SetUlChannel(nullptr);
@@ -105,34 +112,63 @@ void UeLtePhy::DoSetBandwidthManager(void) {
 }
 
 void UeLtePhy::StartTx(shared_ptr<PacketBurst> p) {
-	DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+	DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
 		cout << "Node " << GetDevice()->GetIDNetworkNode() << " starts phy tx"
 				<< endl;
-	DEBUG_LOG_END
+	DEBUG_TRACE_END
 
-	GetUlChannel()->StartTx(p, GetTxSignal(), GetDevice());
+	LteChannel* ulChannel = GetUlChannel();
+	UserEquipment* ue = GetDevice();
+	ENodeB* target = ue->GetTargetNode();
+	// with lazy realizations, the first transmission creates the uplink
+	// realization and starts the sounding that had to wait for it
+	bool firstTx = ulChannel->GetLazyRealizations()
+			&& ulChannel->GetPropagationLossModel()->GetChannelRealization(ue,
+					target) == nullptr;
+	if (firstTx) {
+		ulChannel->GetChannelRealization(ue, target);
+	}
+	ulChannel->StartTx(p, GetTxSignal(), ue);
+	if (firstTx) {
+		SendReferenceSymbols();
+	}
 }
 
 void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src) {	// by zyb
 
 }
 
+bool UeLtePhy::IsRxNeeded(TransmittedSignal* txSignal, NetworkNode* src) {
+	// nothing to decode and no CQI to report, or an MBSFN subframe
+	// without an MBSFN signal for this UE
+	UserEquipment* ue = GetDevice();
+	bool mbsfnSubframe = FrameContext::Get().m_mbsfn;
+	if (ue->GetCqiManager()->NeedToSendFeedbacks() == false
+			&& m_channelsForRx.size() == 0 && !mbsfnSubframe) {
+		return false;
+	}
+	if (mbsfnSubframe
+			&& (txSignal->GetIsMBSFNSignal() == false
+					|| ue->GetMulticastDestination() == nullptr)) {
+		return false;
+	}
+	return true;
+}
+
 void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
-	DEBUG_LOG_START_1(LTE_SIM_TEST_DEVICE_ON_CHANNEL)
+	DEBUG_TRACE_START(DEBUG_DEVICE_ON_CHANNEL)
 		cout << "Node " << GetDevice()->GetIDNetworkNode() << " starts phy rx"
 				<< endl;
-	DEBUG_LOG_END
+	DEBUG_TRACE_END
 
 	m_sinrForCQI.clear();
+	const FrameContext& frame = FrameContext::Get();
 
 	//COMPUTE THE SINR
-	vector<vector<double> > rxSignalValues;
-	vector<vector<float> > rxSignalPhases;
 	vector<double> sinrForBLER;
 
-	rxSignalValues = rxSignal->GetValues();
-	rxSignalPhases = rxSignal->GetPhases();
-	bool isMbsfnSignal = rxSignal->GetIsMBSFNSignal();
+	m_rxSignal.Load(rxSignal);
+	bool rxNeeded = IsRxNeeded(rxSignal, nullptr);
 	delete rxSignal;
 
 	//compute noise + interference
@@ -145,42 +181,31 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 		interference = 0;
 	}
 
-	double noise_interference = 10.
-			* log10(pow(10., GetThermalNoise() / 10) + interference); // dB
+	double noise_interference = GetNoiseInterference(interference); // dB
 	int txMode = ue->GetTargetNodeRecord()->GetDlTxMode();
 	if (ue->GetMulticastDestination() != nullptr) {
-		if ((FrameManager::Init()->MbsfnEnabled() == true
-				&& FrameManager::Init()->isMbsfnSubframe() == true)
-				|| FrameManager::Init()->MbsfnEnabled() == false) {
+		if (frame.m_mbsfn || frame.m_mbsfnEnabled == false) {
 			txMode = ue->GetTargetNodeRecord()->GetDlTxMode();
 		}
 	}
-	int nbOfSubChannels = rxSignalValues.at(0).size();
+	int nbOfSubChannels = m_rxSignal.GetNbSubChannels();
 	int nbOfRxSubChannels = m_channelsForRx.size();
-	int nbOfPaths = rxSignalValues.size();
+	int nbOfPaths = m_rxSignal.GetNbPaths();
 	int nbRxAntennas = GetRxAntennas();
 	int nbTxAntennas = nbOfPaths / nbRxAntennas;
 //if(isMbsfnSignal)cout << "MBSFN signal in ue-lte-phy" << endl;
-	if ((ue->GetCqiManager()->NeedToSendFeedbacks() == false
-			&& nbOfRxSubChannels == 0
-			&& !(FrameManager::Init()->MbsfnEnabled() == true
-					&& FrameManager::Init()->isMbsfnSubframe() == true))
-			|| (FrameManager::Init()->MbsfnEnabled() == true
-					&& FrameManager::Init()->isMbsfnSubframe() == true
-					&& (isMbsfnSignal == false
-							|| ue->GetMulticastDestination() == nullptr))) {
+	if (!rxNeeded) {
 		return;
 	}
 
-	if (FrameManager::Init()->MbsfnEnabled() == true
-			&& FrameManager::Init()->isMbsfnSubframe() == true) {
+	if (frame.m_mbsfn) {
 		m_measuredMBSFNSinr.clear();
 	}
 
 	double power; // power transmission for one sub channel [dB]
 	switch (txMode) {
 	case 1:
-		if (FrameManager::Init()->isMbsfnSubframe() == true) {
+		if (frame.m_mbsfnSubframe == true) {
 			double mbsfnConstructiveInterference;
 			if (GetInterference() != nullptr) {
 				mbsfnConstructiveInterference =
@@ -188,30 +213,31 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			} else {
 				mbsfnConstructiveInterference = 0;
 			}
-			for (auto power : rxSignalValues.at(0)) {
-				m_sinrForCQI.push_back(
-						10.
-								* log10(
-										pow(10, power / 10.)
-												+ mbsfnConstructiveInterference)
-								- noise_interference);
+			const double* rxPowers = m_rxSignal.GetLinearValues(0);
+			m_sinrForCQI.resize(nbOfSubChannels);
+			for (int i = 0; i < nbOfSubChannels; i++) {
+				m_sinrForCQI.at(i) = rxPowers[i] + mbsfnConstructiveInterference;
+			}
+			LinearToDb(m_sinrForCQI.data(), m_sinrForCQI.data(),
+					nbOfSubChannels);
+			for (int i = 0; i < nbOfSubChannels; i++) {
+				m_sinrForCQI.at(i) -= noise_interference;
 			}
-			if (FrameManager::Init()->MbsfnEnabled() == true
-					&& FrameManager::Init()->isMbsfnSubframe() == true) {
+			if (frame.m_mbsfn) {
 				m_measuredMBSFNSinr = m_sinrForCQI;
 			}
 
 		} else if (nbRxAntennas == 1) {
-			for (auto power : rxSignalValues.at(0)) {
-				m_sinrForCQI.push_back(power - noise_interference);
+			for (int i = 0; i < nbOfSubChannels; i++) {
+				m_sinrForCQI.push_back(
+						m_rxSignal.GetValue(0, i) - noise_interference);
 			}
 		} else {
 			arma::vec powers = arma::vec(nbOfPaths); // power received from each path [W]
 			arma::vec H0 = arma::vec(nbOfPaths); // linear gain of each path
 			for (int i = 0; i < nbOfSubChannels; i++) {
 				for (int j = 0; j < nbOfPaths; j++) {
-					powers(j) = pow(10,
-							(long double) rxSignalValues.at(j).at(i) / 10);
+					powers(j) = m_rxSignal.GetLinearValue(j, i);
 				}
 
 				double avgPower = arma::mean(powers);
@@ -227,12 +253,11 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 								- (noise_interference + 10 * log10(sum)));
 			}
 
-			DEBUG_LOG_START_1(CALIBRATION_STEP1)
+			DEBUG_TRACE_START(DEBUG_CALIBRATION_STEP1)
 				double step1a_power = enb->GetPhy()->GetTxPower() - 30
 						- 10 * log10(nbOfSubChannels);
 				ChannelRealization* c_dl;
-				if (FrameManager::Init()->MbsfnEnabled() == true
-						&& FrameManager::Init()->isMbsfnSubframe() == true) {
+				if (frame.m_mbsfn) {
 					c_dl =
 							GetDlMcChannel()->GetPropagationLossModel()->GetChannelRealization(
 									enb, ue);
@@ -253,7 +278,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 
 				cout << "CALIBRATION_1 PATHGAIN " << -step1a_loss << " SINR "
 						<< step1a_sinr << " SINR_FF " << step1c_sinr << endl;
-			DEBUG_LOG_END
+			DEBUG_TRACE_END
 		}
 		sinrForBLER = m_sinrForCQI;
 		break;
@@ -263,9 +288,8 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			arma::mat powers = arma::mat(nbRxAntennas, nbTxAntennas); // power received from each path [W]
 			for (int j = 0; j < nbRxAntennas; j++) {
 				for (int k = 0; k < nbTxAntennas; k++) {
-					powers(j, k) = pow(10,
-							(long double) rxSignalValues.at(
-									j * nbTxAntennas + k).at(i) / 10);
+					powers(j, k) = m_rxSignal.GetLinearValue(
+							j * nbTxAntennas + k, i);
 				}
 			}
 			double avgPower = arma::mean(
@@ -297,14 +321,21 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			maxLayers = m_rankForRx;
 		}
 
+		double noiseInterferenceLinear = DbToLinear(noise_interference);
+
+		// precoded channel of every sub channel, for each number of layers
+		vector<vector<complex<double> > > precodedChannels(maxLayers);
+		for (int l = max(minLayers, 2); l <= maxLayers; l++) {
+			precodedChannels.at(l - 1).resize(nbOfSubChannels * nbRxAntennas * l);
+		}
+
 		// calculate SINR for each number of layers
 		measuredSinr.resize(nbRxAntennas);
 		for (int i = 0; i < nbOfSubChannels; i++) {
 			for (int j = 0; j < nbRxAntennas; j++) {
 				for (int k = 0; k < nbTxAntennas; k++) {
-					powers(j, k) = pow(10,
-							(long double) rxSignalValues.at(
-									j * nbTxAntennas + k).at(i) / 10);
+					powers(j, k) = m_rxSignal.GetLinearValue(
+							j * nbTxAntennas + k, i);
 				}
 			}
 			double avgPower = arma::mean(
@@ -314,7 +345,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			for (int j = 0; j < nbRxAntennas; j++) {
 				for (int k = 0; k < nbTxAntennas; k++) {
 					H0(j, k) = polar(sqrt(abs(powers(j, k)) / avgPathPower),
-							(double) rxSignalPhases[j * nbTxAntennas + k][i]);
+							(double) m_rxSignal.GetPhase(j * nbTxAntennas + k, i));
 				}
 			}
 			for (int l = minLayers; l <= maxLayers; l++) {
@@ -340,35 +371,31 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 								* (*mimo_codebook_4tx[12 + i % l][l - 1])
 								* (*CDD_D[l - 1][i % l]) * (*CDD_U[l - 1]);
 					}
-					arma::cx_mat HHTN = avgPower * precodedH0
-							* arma::trans(precodedH0)
-							+ pow(10, noise_interference / 10)
-									* arma::eye<arma::mat>(nbRxAntennas,
-											nbRxAntennas);
-					arma::cx_mat W = arma::inv(HHTN, true) * sqrt(avgPower)
-							* precodedH0;
-					arma::cx_mat correlation = arma::trans(W) * sqrt(avgPower)
-							* precodedH0;
-					arma::cx_mat D = arma::diagmat(correlation);
-					arma::cx_mat Iself = correlation - D;
-					arma::vec SINRs = arma::abs(
-							arma::diagvec(D * arma::trans(D)))
-							/ arma::abs(
-									arma::diagvec(
-											Iself * arma::trans(Iself)
-													+ pow(10,
-															noise_interference
-																	/ 10)
-															* arma::trans(W)
-															* W));
-					vector<double> sinrs = arma::conv_to<vector<double> >::from(
-							10 * log10(SINRs));
-					double effsinr = GetMiesmEffectiveSinr(sinrs);
-					measuredSinr.at(l - 1).push_back(effsinr);
+					// the MMSE SINRs of all sub channels are computed below in one batch
+					complex<double>* h = &precodedChannels.at(l - 1).at(
+							i * nbRxAntennas * l);
+					for (int n = 0; n < nbRxAntennas * l; n++) {
+						h[n] = sqrt(avgPower) * precodedH0(n);
+					}
 				}
 			}
 		}
 
+		vector<double> layerSinrs;
+		vector<double> sinrs;
+		for (int l = max(minLayers, 2); l <= maxLayers; l++) {
+			layerSinrs.resize(nbOfSubChannels * l);
+			sinrs.resize(l);
+			MmseSinrBatch(nbRxAntennas, l, nbOfSubChannels,
+					precodedChannels.at(l - 1).data(), noiseInterferenceLinear,
+					layerSinrs.data());
+			for (int i = 0; i < nbOfSubChannels; i++) {
+				LinearToDb(&layerSinrs.at(i * l), sinrs.data(), l);
+				double effsinr = ComputeMiesmEffectiveSinr(sinrs);
+				measuredSinr.at(l - 1).push_back(effsinr);
+			}
+		}
+
 		// compute RI feedback
 		AMCModule *amc =
 				GetDevice()->GetProtocolStack()->GetMacEntity()->GetAmcModule();
@@ -386,7 +413,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			}
 			int MCS = amc->GetMCSFromCQI(
 					amc->GetCQIFromSinr(
-							GetMiesmEffectiveSinr(sinrForScheduledChannels)));
+							ComputeMiesmEffectiveSinr(sinrForScheduledChannels)));
 			int TBS = amc->GetTBSizeFromMCS(MCS, MCS,
 					sinrForScheduledChannels.size(), l);
 			if (TBS > maxTBS) {
@@ -411,7 +438,8 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 
 	case 4:
 	case 9: {
-		vector<vector<vector<double> > > measuredSinr; //measured SINR for each number of layers, PMI and subchannel
+		MimoState* mimo = GetMimoState();
+		vector<vector<vector<double> > >& measuredSinr = mimo->m_measuredSinr; //measured SINR for each number of layers, PMI and subchannel
 		arma::cx_fmat powers = arma::cx_fmat(nbRxAntennas, nbTxAntennas); // power received from each path [W]
 
 		int minLayers = 1;
@@ -426,12 +454,22 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			maxLayers = m_rankForRx;
 		}
 
-		measuredSinr.resize(maxLayers);
+		if ((int) measuredSinr.size() < maxLayers) {
+			measuredSinr.resize(maxLayers);
+			mimo->m_measuredPmis.resize(maxLayers);
+			mimo->m_isMeasuredPmi.resize(maxLayers);
+		}
+		while ((int) mimo->m_precoderLayers.size() < nbTxAntennas) {
+			vector<int> layers(mimo->m_precoderLayers.size() + 1);
+			for (int n = 0; n < (int) layers.size(); n++) {
+				layers.at(n) = n;
+			}
+			mimo->m_precoderLayers.push_back(layers);
+		}
 
 		arma::cx_fmat H0 = arma::cx_fmat(nbRxAntennas, nbTxAntennas); // linear gain of each path
 		arma::cx_fmat receivedSignalLevels = arma::cx_fmat(nbRxAntennas,
 				nbTxAntennas); // signal level of each path
-		arma::cx_fmat precoding;
 		arma::cx_fmat precodedH0;
 		arma::cx_fmat HHTN;
 		arma::cx_fmat W;
@@ -472,12 +510,47 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			}
 		}
 
+		// PMIs not evaluated keep -INFINITY and are never preferred. The
+		// buffers are reused between receptions: only the PMIs evaluated
+		// by the previous one are reset
+		CodebookStore* codebooks = CodebookStore::Init();
+		int nbPmis = codebooks->GetMaxPmi(nbTxAntennas) + 1;
+		for (int l = minLayers; l <= maxLayers; l++) {
+			vector<vector<double> >& layerSinr = measuredSinr.at(l - 1);
+			vector<int>& measuredPmis = mimo->m_measuredPmis.at(l - 1);
+			vector<bool>& isMeasuredPmi = mimo->m_isMeasuredPmi.at(l - 1);
+			if ((int) layerSinr.size() != nbPmis
+					|| (int) layerSinr.at(0).size() != nbOfSubChannels) {
+				layerSinr.assign(nbPmis,
+						vector<double>(nbOfSubChannels, -INFINITY));
+				isMeasuredPmi.assign(nbPmis, false);
+			} else {
+				for (int pmi : measuredPmis) {
+					fill(layerSinr.at(pmi).begin(), layerSinr.at(pmi).end(),
+							-INFINITY);
+					isMeasuredPmi.at(pmi) = false;
+				}
+			}
+			measuredPmis.clear();
+		}
+		vector<int> pmiCandidates;
+
+		if (nbOfSubChannels > 0) {
+			if (m_rankForRx < 1
+					|| m_rankForRx > min(nbRxAntennas, nbTxAntennas)) {
+				m_rankForRx = min(nbRxAntennas, nbTxAntennas);
+			}
+			if (mimo->m_assignedLayers.size() == 0) {
+				for (int n = 0; n < m_rankForRx; n++)
+					mimo->m_assignedLayers.push_back(n);
+			}
+		}
+
 		for (int i = 0; i < nbOfSubChannels; i++) {
 			for (int j = 0; j < nbRxAntennas; j++) {
 				for (int k = 0; k < nbTxAntennas; k++) {
-					powers(j, k) = pow(10,
-							(long double) rxSignalValues.at(
-									j * nbTxAntennas + k).at(i) / 10);
+					powers(j, k) = m_rxSignal.GetLinearValue(
+							j * nbTxAntennas + k, i);
 				}
 			}
 
@@ -488,110 +561,121 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 				for (int k = 0; k < nbTxAntennas; k++) {
 					H0(j, k) = polar(
 							(float) (sqrt(abs(powers(j, k)) / avgPathPower)),
-							rxSignalPhases[j * nbTxAntennas + k][i]);
+							m_rxSignal.GetPhase(j * nbTxAntennas + k, i));
 					receivedSignalLevels(j, k) = polar(
 							(float) sqrt(abs(powers(j, k))),
-							rxSignalPhases[j * nbTxAntennas + k][i]);
+							m_rxSignal.GetPhase(j * nbTxAntennas + k, i));
 				}
 			}
 
-			for (int l = minLayers; l <= maxLayers; l++) {
-				int min_pmi, max_pmi;
-				if (nbTxAntennas == 2 && l == 1) {
-					min_pmi = 0;
-					max_pmi = 3;
-				} else if (nbTxAntennas == 2 && l == 2) {
-					min_pmi = 1;
-					max_pmi = 2;
-				} else if (nbTxAntennas == 4) {
-					min_pmi = 0;
-					max_pmi = 15;
-				} else if (nbTxAntennas == 8) {
-					min_pmi = 0;
-					// for 8 tx antennas, PMI is composed of two values, i1 and i2
-					// here, they are encoded as i1 * 16 + i2 for easier looping
-					max_pmi = 255;
+			// effective SINR of the sub-band for one PMI
+			auto computePmiSinr = [&](int l, int pmi) {
+				const arma::cx_fmat& precoding = codebooks->GetPrecoding(
+						nbTxAntennas, l, pmi);
+				return ComputeMiesmEffectiveSinr(
+						SinrCalculator::MimoReception(receivedSignalLevels,
+								precoding, noise_interference,
+								mimo->m_precoderLayers.at(precoding.n_cols - 1)));
+			};
+			auto evaluatePmi = [&](int l, int pmi) {
+				double effsinr = computePmiSinr(l, pmi);
+				if (!mimo->m_isMeasuredPmi.at(l - 1).at(pmi)) {
+					mimo->m_isMeasuredPmi.at(l - 1).at(pmi) = true;
+					mimo->m_measuredPmis.at(l - 1).push_back(pmi);
 				}
+				measuredSinr.at(l - 1).at(pmi).at(i) = effsinr;
+				if (subBandSize > 1 && nbOfSubChannels > 0) {
+					for (int n = i + 1;
+							n < min(i + subBandSize, nbOfSubChannels); n++) {
+						measuredSinr.at(l - 1).at(pmi).at(n) = effsinr;
+					}
+				}
+			};
+			// evaluates the PMIs not evaluated yet, returns the best one so far
+			auto searchPmis = [&](int l, const vector<int>& pmis) {
+				int bestPmi = pmis.at(0);
+				for (int pmi : pmis) {
+					if (measuredSinr.at(l - 1).at(pmi).at(i) == -INFINITY) {
+						evaluatePmi(l, pmi);
+					}
+					if (measuredSinr.at(l - 1).at(pmi).at(i)
+							> measuredSinr.at(l - 1).at(bestPmi).at(i)) {
+						bestPmi = pmi;
+					}
+				}
+				return bestPmi;
+			};
 
-				measuredSinr.at(l - 1).resize(max_pmi + 1);
-
+			for (int l = minLayers; l <= maxLayers; l++) {
 				// restrict PMI choice if CQI feedback is not required
 				if (ue->GetCqiManager()->NeedToSendFeedbacks() == false) {
-
+					// not important if not received, this sub-band is not accounted in BLER evaluation
+					int pmi = 0;
 					if (find(m_channelsForRx.begin(), m_channelsForRx.end(), i)
 							!= m_channelsForRx.end()) {
 						int index = distance(m_channelsForRx.begin(),
 								find(m_channelsForRx.begin(),
 										m_channelsForRx.end(), i));
 						if (nbTxAntennas == 8) {
-							min_pmi = m_pmiForRx.at(index).at(0) * 16
-									+ m_pmiForRx.at(index).at(1);
-							max_pmi = m_pmiForRx.at(index).at(0) * 16
+							pmi = m_pmiForRx.at(index).at(0) * 16
 									+ m_pmiForRx.at(index).at(1);
 						} else {
-							min_pmi = m_pmiForRx.at(index).at(0);
-							max_pmi = m_pmiForRx.at(index).at(0);
+							pmi = m_pmiForRx.at(index).at(0);
 						}
-					} else {
-						// not important, this sub-band is not accounted in BLER evaluation
-						min_pmi = 0;
-						max_pmi = 0;
 					}
-				}
-
-				for (int pmi = min_pmi; pmi <= max_pmi; pmi++) {
-					if (nbTxAntennas == 2) {
-						precoding = arma::conv_to<arma::cx_fmat>::from(
-								*mimo_codebook_2tx[pmi][l - 1]);
-					} else if (nbTxAntennas == 4) {
-						precoding = arma::conv_to<arma::cx_fmat>::from(
-								*mimo_codebook_4tx[pmi][l - 1]);
-					} else if (nbTxAntennas == 8) {
-						// limits on i1 values, depending on layers
-						if ((l > 2 && pmi / 16 > 3)
-								|| (l == 8 && pmi / 16 > 0)) {
-							break;
-						}
-						precoding = arma::conv_to<arma::cx_fmat>::from(
-								codebook_8tx(l, pmi / 16, pmi % 16));
+					// limits on i1 values, depending on layers
+					if (nbTxAntennas != 8
+							|| !((l > 2 && pmi / 16 > 3)
+									|| (l == 8 && pmi / 16 > 0))) {
+						evaluatePmi(l, pmi);
 					}
+					continue;
+				}
 
-					if (m_rankForRx < 1
-							|| m_rankForRx > min(nbRxAntennas, nbTxAntennas)) {
-						m_rankForRx = min(nbRxAntennas, nbTxAntennas);
-					}
-					if (m_assignedLayers.size() == 0) {
-						for (int n = 0; n < m_rankForRx; n++)
-							m_assignedLayers.push_back(n);
-					}
+				const vector<int>& allPmis = codebooks->GetSearchPmis(
+						nbTxAntennas, l);
+				int bestPmi;
+				if (m_pmiSearch == PMI_SEARCH_GREEDY) {
+					// i1 first, then i2 for the best i1
+					codebooks->GetFirstStagePmis(nbTxAntennas, l, pmiCandidates);
+					bestPmi = searchPmis(l, pmiCandidates);
+					codebooks->GetSecondStagePmis(nbTxAntennas, l, bestPmi,
+							pmiCandidates);
+					bestPmi = searchPmis(l, pmiCandidates);
+				} else if (m_pmiSearch == PMI_SEARCH_NEIGHBOURHOOD
+						&& (int) mimo->m_previousPmis.size() >= l
+						&& (int) mimo->m_previousPmis.at(l - 1).size() > i) {
+					codebooks->GetNeighbourPmis(nbTxAntennas, l,
+							mimo->m_previousPmis.at(l - 1).at(i), pmiCandidates);
+					bestPmi = searchPmis(l, pmiCandidates);
+				} else {
+					bestPmi = searchPmis(l, allPmis);
+				}
 
-					vector<int> assignedLayers;
-					for (int l1 = 0; l1 < (int) precoding.n_cols; l1++) {
-						assignedLayers.push_back(l1);
-					}
-					vector<double> sinrs = SinrCalculator::MimoReception(
-							receivedSignalLevels, precoding, noise_interference,
-							assignedLayers);
-
-					double effsinr = GetMiesmEffectiveSinr(sinrs);
-					measuredSinr.at(l - 1).at(pmi).resize(nbOfSubChannels);
-					measuredSinr.at(l - 1).at(pmi).at(i) = effsinr;
-
-					if (subBandSize > 1 && nbOfSubChannels > 0) {
-						for (int n = i + 1;
-								n < min(i + subBandSize, nbOfSubChannels);
-								n++) {
-							measuredSinr.at(l - 1).at(pmi).at(n) = effsinr;
+				if (m_pmiSearchCheck && m_pmiSearch != PMI_SEARCH_EXHAUSTIVE) {
+					// the PMIs the search skipped cost the check only, not
+					// the search: they are profiled apart
+					EventProfiler::Scope profileCheck("UeLtePhy::PmiSearchCheck");
+					double bestSinr = measuredSinr.at(l - 1).at(bestPmi).at(i);
+					int exhaustivePmi = bestPmi;
+					double exhaustiveSinr = bestSinr;
+					for (int pmi : allPmis) {
+						double sinr = measuredSinr.at(l - 1).at(pmi).at(i);
+						if (sinr == -INFINITY) {
+							sinr = computePmiSinr(l, pmi);
 						}
-					}
-					if (nbTxAntennas == 8) {
-						// limits on i2 values, depending on layers
-						if (l == 4 && pmi % 16 == 7) {
-							pmi += 8;
-						} else if (l > 4) {
-							pmi += 15;
+						if (sinr > exhaustiveSinr) {
+							exhaustiveSinr = sinr;
+							exhaustivePmi = pmi;
 						}
 					}
+					TraceSink* trace = TraceSink::Init();
+					if (exhaustivePmi != bestPmi
+							&& trace->IsEnabled(TraceSink::TRACE_PMI_SEARCH)) {
+						trace->TracePmiSearch(ue->GetIDNetworkNode(), l, i,
+								bestPmi, exhaustivePmi,
+								exhaustiveSinr - bestSinr);
+					}
 				}
 			}
 			if (subBandSize > 1 && nbOfSubChannels > 0) {
@@ -682,7 +766,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 		effSinrForPreferredPmis.resize(nbRxAntennas);
 		int maxTBS = 0;
 		m_rankForRiFeedback = 1;
-		m_pmiForFeedback.resize(nbOfSubChannels);
+		mimo->m_pmiForFeedback.resize(nbOfSubChannels);
 		for (int l = minLayers; l <= maxLayers; l++) {
 			vector<double> sinrForScheduledChannels;
 			sinrForScheduledChannels.clear();
@@ -693,7 +777,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			if (sinrForScheduledChannels.size() == 0) {
 				sinrForScheduledChannels = SinrForPreferredPmis.at(l - 1);
 			}
-			effSinrForPreferredPmis.at(l - 1) = GetMiesmEffectiveSinr(
+			effSinrForPreferredPmis.at(l - 1) = ComputeMiesmEffectiveSinr(
 					sinrForScheduledChannels);
 			int MCS = amc->GetMCSFromCQI(
 					amc->GetCQIFromSinr(effSinrForPreferredPmis.at(l - 1)));
@@ -704,20 +788,23 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 				maxTBS = TBS;
 				for (int i = 0; i < nbOfSubChannels; i++) {
 					if (nbTxAntennas == 8) {
-						m_pmiForFeedback.at(i).resize(2);
-						m_pmiForFeedback.at(i).at(0) =
+						mimo->m_pmiForFeedback.at(i).resize(2);
+						mimo->m_pmiForFeedback.at(i).at(0) =
 								preferredPmis.at(l - 1).at(i) / 16;
-						m_pmiForFeedback.at(i).at(1) =
+						mimo->m_pmiForFeedback.at(i).at(1) =
 								preferredPmis.at(l - 1).at(i) % 16;
 					} else {
-						m_pmiForFeedback.at(i).resize(1);
-						m_pmiForFeedback.at(i).at(0) =
+						mimo->m_pmiForFeedback.at(i).resize(1);
+						mimo->m_pmiForFeedback.at(i).at(0) =
 								preferredPmis.at(l - 1).at(i);
 					}
 				}
 			}
 		}
 		m_sinrForCQI = SinrForPreferredPmis.at(m_rankForRiFeedback - 1);
+		if (ue->GetCqiManager()->NeedToSendFeedbacks()) {
+			mimo->m_previousPmis = preferredPmis;
+		}
 
 		sinrForBLER.resize(nbOfSubChannels);
 		if (m_rankForRx < 1 || m_rankForRx > min(nbRxAntennas, nbTxAntennas)) {
@@ -759,6 +846,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 
 	case 11: // Not a real LTE TM. Represents m-MIMO+GoB
 	{
+		MimoState* mimo = GetMimoState();
 		vector<double> measuredSinr; // received sinr for each subchannel
 		measuredSinr.resize(nbOfSubChannels);
 		arma::cx_fmat powers = arma::cx_fmat(nbRxAntennas, nbTxAntennas);
@@ -769,14 +857,13 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 		arma::cx_fmat precodedH0;
 		arma::fvec SINRs;
 
-		m_fullCsiFeedback.clear();
+		mimo->m_fullCsiFeedback.clear();
 
 		for (int i = 0; i < nbOfSubChannels; i++) {
 			for (int j = 0; j < nbRxAntennas; j++) {
 				for (int k = 0; k < nbTxAntennas; k++) {
-					powers(j, k) = pow(10,
-							(long double) rxSignalValues.at(
-									j * nbTxAntennas + k).at(i) / 10);
+					powers(j, k) = m_rxSignal.GetLinearValue(
+							j * nbTxAntennas + k, i);
 				}
 			}
 
@@ -787,7 +874,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 				for (int k = 0; k < nbTxAntennas; k++) {
 					receivedSignalLevels(j, k) = polar(
 							(float) sqrt(abs(powers(j, k))),
-							rxSignalPhases[j * nbTxAntennas + k][i]);
+							m_rxSignal.GetPhase(j * nbTxAntennas + k, i));
 				}
 			}
 			if (ue->GetCqiManager()->NeedToSendFeedbacks() == true) {
@@ -799,7 +886,7 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 				double threshold_db = INFINITY;
 				channelMatrixForFeedback->for_each(
 						[max_value, threshold_db](complex<float>& val) {if(max_value/abs(val) > pow(10,threshold_db/20)) {val = 0;}});
-				m_fullCsiFeedback.push_back(channelMatrixForFeedback);
+				mimo->m_fullCsiFeedback.push_back(channelMatrixForFeedback);
 			}
 
 			if (m_rankForRx < 1
@@ -817,33 +904,34 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 				int index = distance(m_channelsForRx.begin(),
 						find(m_channelsForRx.begin(), m_channelsForRx.end(),
 								i));
-				if (m_precodingMatricesForRx.at(index) != nullptr) {
-					precoding = *m_precodingMatricesForRx.at(index);
+				if ((int) mimo->m_precodingMatricesForRx.size() > index
+						&& mimo->m_precodingMatricesForRx.at(index) != nullptr) {
+					precoding = *mimo->m_precodingMatricesForRx.at(index);
 				} else {
 					//TODO: how to measure channel quality when channel is not scheduled (i.e. when not using round robin)?
 					precoding = arma::eye<arma::cx_fmat>(nbTxAntennas,
 							nbRxAntennas);
-					m_assignedLayers.clear();
+					mimo->m_assignedLayers.clear();
 				}
 			} else {
 				//TODO: how to measure channel quality when channel is not scheduled (i.e. when not using round robin)?
 				precoding = arma::eye<arma::cx_fmat>(nbTxAntennas,
 						nbRxAntennas);
-				m_assignedLayers.clear();
+				mimo->m_assignedLayers.clear();
 			}
 
-			if (m_assignedLayers.size() == 0) {
+			if (mimo->m_assignedLayers.size() == 0) {
 //                  for (int n = 0; n < nbRxAntennas; n++)
 				for (int n = 0; n < 1; n++)
-					m_assignedLayers.push_back(n);
+					mimo->m_assignedLayers.push_back(n);
 			}
 
 			vector<double> sinrs;
 
 			bool use_srta_pi = false;
 			if (GetSrtaPi() == true) {
-				if ((int) m_channelMatricesForSrtaPi.size() > i) {
-					if (m_channelMatricesForSrtaPi.at(i) != nullptr) {
+				if ((int) mimo->m_channelMatricesForSrtaPi.size() > i) {
+					if (mimo->m_channelMatricesForSrtaPi.at(i) != nullptr) {
 						use_srta_pi = true;
 					}
 				}
@@ -857,15 +945,15 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			if (use_srta_pi == true) {
 				sinrs = SinrCalculator::MimoReception(
 //                  sinrs = SinrCalculator::MimoReceptionMRC(
-						*m_channelMatricesForSrtaPi.at(i), precoding,
-						noise_interference, m_assignedLayers, dopplerSIR);
+						*mimo->m_channelMatricesForSrtaPi.at(i), precoding,
+						noise_interference, mimo->m_assignedLayers, dopplerSIR);
 			} else {
 				sinrs = SinrCalculator::MimoReception(
 //                  sinrs = SinrCalculator::MimoReceptionMRC(
 						receivedSignalLevels, precoding, noise_interference,
-						m_assignedLayers, dopplerSIR);
+						mimo->m_assignedLayers, dopplerSIR);
 			}
-			double effsinr = GetMiesmEffectiveSinr(sinrs);
+			double effsinr = ComputeMiesmEffectiveSinr(sinrs);
 			measuredSinr.at(i) = effsinr;
 
 			// use simple formula for the CQI. the base station needs to adjust it to include MU-MIMO interference
@@ -875,30 +963,30 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 //              m_sinrForCQI.push_back(effsinr);
 		}
 
-		DEBUG_LOG_START_1(LTE_SIM_MCS_DEBUG)
+		DEBUG_TRACE_START(DEBUG_MCS)
 			cout << "MCS_DEBUG UE " << GetDevice()->GetIDNetworkNode()
 					<< ", SINR for CQI " << m_sinrForCQI << endl;
-		DEBUG_LOG_END
+		DEBUG_TRACE_END
 		m_rankForRiFeedback = m_rankForRx;
 //          m_rankForRiFeedback = 1;
 		sinrForBLER = measuredSinr;
-		DEBUG_LOG_START_1(LTE_SIM_MCS_DEBUG)
+		DEBUG_TRACE_START(DEBUG_MCS)
 			if (nbOfRxSubChannels > 0) {
 				cout << "MCS_DEBUG UE " << GetDevice()->GetIDNetworkNode()
 						<< ", SINR forBLER " << sinrForBLER << endl;
-			}DEBUG_LOG_END
+			}DEBUG_TRACE_END
 
 		if (m_channelsForRx.size() > 0) {
 			// FIXME: overriding selected MCS, until proper eNB-side link adaptation is implemented
 			AMCModule *amc = ue->GetMacEntity()->GetAmcModule();
 
-			DEBUG_LOG_START_2(LTE_SIM_MCS_DEBUG,LTE_SIM_MCS_OVERRIDING_DEBUG)
+			DEBUG_TRACE_START_2(DEBUG_MCS,DEBUG_MCS_OVERRIDING)
 //              cout << "MCS_DEBUG eNB mcs " << m_mcsIndexForRx.at(0)
 //                   << " UE " << GetDevice()->GetIDNetworkNode()
 //                   << " mcs " << amc->GetMCSFromSinrVector(sinrForBLER)
 //                   << " harq " << ((UeMacEntity*)GetDevice ()->GetProtocolStack ()->GetMacEntity ())->GetHarqManager ()->ReceiveProcessExists (m_harqPidForRx)
 //                   << endl;
-			DEBUG_LOG_END
+			DEBUG_TRACE_END
 //              int mcs = amc->GetMCSFromSinrVector(sinrForBLER);
 //              fill(m_mcsIndexForRx.begin(),m_mcsIndexForRx.end(), mcs);
 		}
@@ -911,14 +999,14 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 	}
 	//CHECK FOR PHY ERROR
 	bool phyError;
+	TraceSink* trace = TraceSink::Init();
 
 	HarqManager *harqManager = ue->GetMacEntity()->GetHarqManager();
 
 	if (GetErrorModel() != nullptr && nbOfRxSubChannels > 0) {
 		vector<double> sinrForBLER_2 = sinrForBLER;
 		if (harqManager != nullptr) {
-			if (!(FrameManager::Init()->MbsfnEnabled() == true
-					&& FrameManager::Init()->isMbsfnSubframe() == true)) {
+			if (!frame.m_mbsfn) {
 				if (harqManager->ReceiveProcessExists(m_harqPidForRx)) {
 					sinrForBLER_2 = harqManager->GetCombinedSinr(m_harqPidForRx,
 							sinrForBLER);
@@ -933,12 +1021,13 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			int cqi = amc->GetCQIFromMCS(m_mcsIndexForRx.at(i));
 			cqi_.push_back(cqi);
 		}
+		RandomStream::Scope randomScope(GetErrorStream());
 		phyError = GetErrorModel()->CheckForPhysicalError(m_channelsForRx, cqi_,
 				sinrForBLER_2);
+		CountPhyError(phyError);
 
 		if (harqManager != nullptr) {
-			if (!(FrameManager::Init()->MbsfnEnabled() == true
-					&& FrameManager::Init()->isMbsfnSubframe() == true)) {
+			if (!frame.m_mbsfn) {
 				if (phyError) {
 					if (harqManager->ReceiveProcessExists(m_harqPidForRx)) {
 						harqManager->UpdateRxProcess(m_harqPidForRx,
@@ -955,14 +1044,8 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 			}
 		}
 
-		if (_PHY_TRACING_) {
-			if (phyError) {
-				cout << "**** YES PHY ERROR (node "
-						<< GetDevice()->GetIDNetworkNode() << ") ****" << endl;
-			} else {
-				cout << "**** NO PHY ERROR (node "
-						<< GetDevice()->GetIDNetworkNode() << ") ****" << endl;
-			}
+		if (_PHY_TRACING_ && trace->IsEnabled(TraceSink::TRACE_PHY_ERROR)) {
+			trace->TracePhyError(GetDevice()->GetIDNetworkNode(), phyError);
 		}
 	} else {
 		phyError = false;
@@ -970,11 +1053,11 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 	// Send HARQ ACK/NACK
 	if (m_mcsIndexForRx.size() > 0 && harqManager != nullptr
 			&& m_harqPidForRx != HarqManager::HARQ_NOT_USED) {
-		DEBUG_LOG_START_1(LTE_SIM_HARQ_DEBUG)
+		DEBUG_TRACE_START(DEBUG_HARQ)
 			cout << "HARQ_DEBUG UE " << GetDevice()->GetIDNetworkNode()
 					<< " pid " << m_harqPidForRx << " error " << phyError
 					<< endl;
-		DEBUG_LOG_END
+		DEBUG_TRACE_END
 		HarqIdealControlMessage* harqAck = new HarqIdealControlMessage();
 		harqAck->SetSourceDevice(ue);
 		harqAck->SetDestinationDevice(ue->GetTargetNode());
@@ -983,8 +1066,8 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 		SendIdealControlMessage(harqAck);
 	}
 
-	if (_PHY_TRACING_) {
-		double effective_sinr = GetMiesmEffectiveSinr(sinrForBLER);
+	if (_PHY_TRACING_ && trace->IsEnabled(TraceSink::TRACE_PHY_RX)) {
+		double effective_sinr = ComputeMiesmEffectiveSinr(sinrForBLER);
 		if (effective_sinr > 40)
 			effective_sinr = 40;
 		int cqi =
@@ -998,30 +1081,28 @@ void UeLtePhy::StartRx(shared_ptr<PacketBurst> p, ReceivedSignal* rxSignal) {
 					GetDevice()->GetProtocolStack()->GetMacEntity()->GetAmcModule()->GetTBSizeFromMCS(
 							m_mcsIndexForRx.at(0), m_mcsIndexForRx.at(0),
 							nbOfRxSubChannels, m_rankForRx);
-			cout << "PHY_RX SRC " << ue->GetTargetNode()->GetIDNetworkNode()
-					<< " DST " << ue->GetIDNetworkNode() << " X "
-					<< ue->GetMobilityModel()->GetAbsolutePosition()->GetCoordinateX()
-					<< " Y "
-					<< ue->GetMobilityModel()->GetAbsolutePosition()->GetCoordinateY()
-					<< " SINR " << effective_sinr << " RB " << nbOfRxSubChannels
-					<< " MCS " << MCS_ << " SIZE " << TBS_ << " ERR "
-					<< phyError << " T " << Simulator::Init()->Now();
+			int coverShift = -1;
 			if (std::getenv("USE_COVERSHIFT") != nullptr) {
-				cout << " CS " << FrameManager::Init()->GetCoverShiftIndex();
+				coverShift = frame.m_coverShiftIndex;
 			}
-			cout << endl;
+			trace->TracePhyRx(ue->GetTargetNode()->GetIDNetworkNode(),
+					ue->GetIDNetworkNode(),
+					ue->GetMobilityModel()->GetAbsolutePosition()->GetCoordinateX(),
+					ue->GetMobilityModel()->GetAbsolutePosition()->GetCoordinateY(),
+					effective_sinr, nbOfRxSubChannels, MCS_, TBS_, phyError,
+					Simulator::Init()->Now(), coverShift);
 		}
 	}
 
 	if (!phyError && p->GetNPackets() > 0) {
 		//FORWARD RECEIVED PACKETS TO THE DEVICE
-		GetDevice()->ReceivePacketBurst(p);
+		GetDevice()->ReceivePacketBurst(p->Copy());
 	}
 
 	//CQI report
 	// for MBSFN, CQIs are collected by the multicast-destination-lte-phy class,
 	// so there is no need to send them from here
-	if (FrameManager::Init()->isMbsfnSubframe() == false) {
+	if (frame.m_mbsfnSubframe == false) {
 		CreateCqiFeedbacks(m_sinrForCQI);
 	}
 
@@ -1046,13 +1127,15 @@ void UeLtePhy::CreateCqiFeedbacks(vector<double> sinr) {
 			ue->GetCqiManager()->CreateRiFeedback(m_rankForRiFeedback);
 		}
 		if (txMode == 4 || txMode == 9) {
+			MimoState* mimo = GetMimoState();
 			ue->GetCqiManager()->CreateRiFeedback(m_rankForRiFeedback);
-			ue->GetCqiManager()->CreatePmiFeedbacks(m_pmiForFeedback);
+			ue->GetCqiManager()->CreatePmiFeedbacks(mimo->m_pmiForFeedback);
 		}
 		if (txMode == 11) {
+			MimoState* mimo = GetMimoState();
 			ue->GetCqiManager()->CreateRiFeedback(m_rankForRiFeedback);
-			ue->GetCqiManager()->CreateFullCsiFeedbacks(m_fullCsiFeedback);
-			m_fullCsiFeedback.clear();
+			ue->GetCqiManager()->CreateFullCsiFeedbacks(mimo->m_fullCsiFeedback);
+			mimo->m_fullCsiFeedback.clear();
 		}
 	}
 }
@@ -1074,14 +1157,14 @@ int UeLtePhy::GetRankForRiFeedback() {
 
 void UeLtePhy::SendIdealControlMessage(IdealControlMessage *msg) {
 
-	DEBUG_LOG_START_1(LTE_SIM_RANDOM_ACCESS)
+	DEBUG_TRACE_START(DEBUG_RANDOM_ACCESS)
 		if (msg->GetMessageType() == IdealControlMessage::RA_PREAMBLE) {
 			cout << "RANDOM_ACCESS SEND_MSG1 UE "
 					<< msg->GetSourceDevice()->GetIDNetworkNode() << " T "
 					<< Simulator::Init()->Now();
 		}
 
-	DEBUG_LOG_END
+	DEBUG_TRACE_END
 
 	NetworkNode* dst = msg->GetDestinationDevice();
 	dst->GetPhy()->ReceiveIdealControlMessage(msg);
@@ -1091,93 +1174,136 @@ void UeLtePhy::SendIdealControlMessage(IdealControlMessage *msg) {
 
 void UeLtePhy::ReceiveIdealControlMessage(IdealControlMessage *msg) {
 	if (msg->GetMessageType() == IdealControlMessage::ALLOCATION_MAP) {
-
-		m_channelsForRx.clear();
-		m_channelsForTx.clear();
-		m_mcsIndexForRx.clear();
-		m_mcsIndexForTx.clear();
-		m_pmiForRx.clear();
-		m_precodingMatricesForRx.clear();
-		m_channelMatricesForSrtaPi.clear();
-
 		PdcchMapIdealControlMessage *map = (PdcchMapIdealControlMessage*) msg;
-
 		int node = GetDevice()->GetIDNetworkNode();
-
-		for (auto allocation : *map->GetMessage()) {
-			if (allocation.m_ue->GetIDNetworkNode() == node) {
-				if (allocation.m_direction
-						== PdcchMapIdealControlMessage::DOWNLINK) {
-					m_channelsForRx.push_back(allocation.m_idSubChannel);
-					m_mcsIndexForRx.push_back(allocation.m_mcsIndex);
-					m_rankForRx = allocation.m_rank;
-					m_pmiForRx.push_back(allocation.m_pmi);
-					m_assignedLayers = allocation.m_assignedLayers;
-					m_harqPidForRx = allocation.m_harqPid;
-					m_precodingMatricesForRx.push_back(
-							allocation.m_precodingMatrix);
-					m_channelMatricesForSrtaPi.push_back(
-							allocation.m_fullCsiMatrix);
-				} else if (allocation.m_direction
-						== PdcchMapIdealControlMessage::UPLINK) {
-					m_channelsForTx.push_back(allocation.m_idSubChannel);
-					m_mcsIndexForTx.push_back(allocation.m_mcsIndex);
-				}
-				DEBUG_LOG_START_1(LTE_SIM_SCHEDULER_DEBUG_NB)
-					cout << "RECEIVE ALLOCATION MAP MESSAGE UE " << node
-							<< " MCS " << m_mcsIndexForTx.at(0)
-							<< " SUBCARRIER " << allocation.m_idSubChannel
-							<< endl;
-				DEBUG_LOG_END
-
+		vector<int> records;
+		for (int i = 0; i < (int) map->GetMessage()->size(); i++) {
+			if (map->GetMessage()->at(i).m_ue->GetIDNetworkNode() == node) {
+				records.push_back(i);
 			}
 		}
-
-		if (m_channelsForTx.size() > 0) {
-			DoSetBandwidthManager();
-			GetDevice()->GetMacEntity()->ScheduleUplinkTransmission(
-					m_channelsForTx.size(), m_mcsIndexForTx.at(0));
-		}
+		ReceiveAllocationMap(map, records);
 	} else if (msg->GetMessageType()
 			== IdealControlMessage::NB_IOT_ALLOCATION_MAP) {
-		m_channelsForRx.clear();
-		m_channelsForTx.clear();
-		m_mcsIndexForRx.clear();
-		m_mcsIndexForTx.clear();
-
 		NbIoTMapIdealControlMessage *map = (NbIoTMapIdealControlMessage*) msg;
-
-		UserEquipment* eq = GetDevice();										// by zyb
-		eq->GetTargetNodeRecord()->SetUlMcs(-1);								// by zyb
-
 		int node = GetDevice()->GetIDNetworkNode();
-		int nru = -1;
-		for (auto allocation : *map->GetMessage()) {
-			if (allocation.m_ue->GetIDNetworkNode() == node) {
-				m_channelsForTx.push_back(allocation.m_idSubChannel);
-				m_mcsIndexForTx.push_back(allocation.m_mcsIndex);
-				nru = allocation.m_ru;
-				eq->GetTargetNodeRecord()->SetUlMcs(m_mcsIndexForTx.at(0));		// by zyb
-				DEBUG_LOG_START_1(LTE_SIM_SCHEDULER_DEBUG_NB)
-					cout << "RECEIVE ALLOCATION MAP MESSAGE UE " << node
-							<< " MCS " << m_mcsIndexForTx.at(0) << " RU " << nru
-							<< " SUBCARRIER " << allocation.m_idSubChannel
-							<< endl;
-				DEBUG_LOG_END
+		vector<int> records;
+		for (int i = 0; i < (int) map->GetMessage()->size(); i++) {
+			if (map->GetMessage()->at(i).m_ue->GetIDNetworkNode() == node) {
+				records.push_back(i);
 			}
 		}
-
-		if (m_channelsForTx.size() > 0) {
-			DoSetBandwidthManager();
-			GetDevice()->GetMacEntity()->ScheduleNbUplinkTransmission(
-					m_mcsIndexForTx.at(0), nru);
-		}
+		ReceiveNbIoTAllocationMap(map, records);
 	} else {
 		GetDevice()->GetMacEntity()->ReceiveIdealControlMessage(msg);
 	}
 }
 
+void UeLtePhy::ReceiveAllocationMap(PdcchMapIdealControlMessage *map,
+		const vector<int>& records) {
+	// single layer records without matrices leave the MIMO state alone,
+	// so UEs that never get a MIMO allocation never allocate it
+	MimoState* mimo = m_mimo.get();
+	m_channelsForRx.clear();
+	m_channelsForTx.clear();
+	m_mcsIndexForRx.clear();
+	m_mcsIndexForTx.clear();
+	m_pmiForRx.clear();
+	if (mimo != nullptr) {
+		mimo->m_precodingMatricesForRx.clear();
+		mimo->m_channelMatricesForSrtaPi.clear();
+	}
+
+	int node = GetDevice()->GetIDNetworkNode();
+
+	for (int i : records) {
+		auto& allocation = map->GetMessage()->at(i);
+		if (allocation.m_direction == PdcchMapIdealControlMessage::DOWNLINK) {
+			m_channelsForRx.push_back(allocation.m_idSubChannel);
+			m_mcsIndexForRx.push_back(allocation.m_mcsIndex);
+			m_rankForRx = allocation.m_rank;
+			m_pmiForRx.push_back(allocation.m_pmi);
+			m_harqPidForRx = allocation.m_harqPid;
+			const vector<int>& layers = allocation.m_assignedLayers;
+			if (mimo == nullptr
+					&& (allocation.m_precodingMatrix != nullptr
+							|| allocation.m_fullCsiMatrix != nullptr
+							|| layers.size() > 1
+							|| (layers.size() == 1 && layers.at(0) != 0))) {
+				mimo = GetMimoState();
+				// the previous records of this map carried no matrix
+				mimo->m_precodingMatricesForRx.assign(
+						m_channelsForRx.size() - 1, nullptr);
+				mimo->m_channelMatricesForSrtaPi.assign(
+						m_channelsForRx.size() - 1, nullptr);
+			}
+			if (mimo != nullptr) {
+				mimo->m_assignedLayers = layers;
+				mimo->m_precodingMatricesForRx.push_back(
+						allocation.m_precodingMatrix);
+				mimo->m_channelMatricesForSrtaPi.push_back(
+						allocation.m_fullCsiMatrix);
+			}
+		} else if (allocation.m_direction
+				== PdcchMapIdealControlMessage::UPLINK) {
+			m_channelsForTx.push_back(allocation.m_idSubChannel);
+			m_mcsIndexForTx.push_back(allocation.m_mcsIndex);
+			// only uplink records fill m_mcsIndexForTx
+			DEBUG_TRACE_START(DEBUG_SCHEDULER_NB)
+				cout << "RECEIVE ALLOCATION MAP MESSAGE UE " << node
+						<< " MCS " << m_mcsIndexForTx.at(0)
+						<< " SUBCARRIER " << allocation.m_idSubChannel
+						<< endl;
+			DEBUG_TRACE_END
+		}
+	}
+
+	if (m_channelsForRx.size() > 0 && GetDlChannel() != nullptr) {
+		GetDlChannel()->AddRecipient(GetDevice()->GetTargetNode(), GetDevice());
+	}
+
+	if (m_channelsForTx.size() > 0) {
+		DoSetBandwidthManager();
+		GetDevice()->GetMacEntity()->ScheduleUplinkTransmission(
+				m_channelsForTx.size(), m_mcsIndexForTx.at(0));
+	}
+}
+
+void UeLtePhy::ReceiveNbIoTAllocationMap(NbIoTMapIdealControlMessage *map,
+		const vector<int>& records) {
+	m_channelsForRx.clear();
+	m_channelsForTx.clear();
+	m_mcsIndexForRx.clear();
+	m_mcsIndexForTx.clear();
+
+	UserEquipment* eq = GetDevice();										// by zyb
+	eq->GetTargetNodeRecord()->SetUlMcs(-1);								// by zyb
+
+	int node = GetDevice()->GetIDNetworkNode();
+	int nru = -1;
+	for (int i : records) {
+		auto& allocation = map->GetMessage()->at(i);
+		m_channelsForTx.push_back(allocation.m_idSubChannel);
+		m_mcsIndexForTx.push_back(allocation.m_mcsIndex);
+		nru = allocation.m_ru;
+		eq->GetTargetNodeRecord()->SetUlMcs(m_mcsIndexForTx.at(0));		// by zyb
+		DEBUG_TRACE_START(DEBUG_SCHEDULER_NB)
+			cout << "RECEIVE ALLOCATION MAP MESSAGE UE " << node
+					<< " MCS " << m_mcsIndexForTx.at(0) << " RU " << nru
+					<< " SUBCARRIER " << allocation.m_idSubChannel
+					<< endl;
+		DEBUG_TRACE_END
+	}
+
+	if (m_channelsForTx.size() > 0) {
+		DoSetBandwidthManager();
+		GetDevice()->GetMacEntity()->ScheduleNbUplinkTransmission(
+				m_mcsIndexForTx.at(0), nru);
+	}
+}
+
 void UeLtePhy::SetTxSignalForReferenceSymbols(void) {
+	EventProfiler::Scope profile("UeLtePhy::SetTxSignalForReferenceSymbols");
 	BandwidthManager* s = GetBandwidthManager();
 	vector<double> channels = s->GetUlSubChannels();
 
@@ -1203,16 +1329,45 @@ UeLtePhy::GetTxSignalForReferenceSymbols(void) {
 }
 
 void UeLtePhy::SendReferenceSymbols(void) {
+	EventProfiler::Scope profile("UeLtePhy::SendReferenceSymbols");
 	UserEquipment* ue = GetDevice();
 	ENodeB* target = ue->GetTargetNode();
 	EnbLtePhy* enbPhy = (EnbLtePhy*) target->GetPhy();
 	ChannelRealization* cr =
 			GetUlChannel()->GetPropagationLossModel()->GetChannelRealization(ue,
 					target);
+	if (cr == nullptr) {
+		// lazy realizations: the UE sounds from its first transmission
+		return;
+	}
 	if (target->GetDLScheduler() != nullptr && cr->hasFastFading() == true) {
+		if (enbPhy->GetBatchedReferenceSymbols() == true) {
+			// from now on the eNB receives the symbols of all its UEs in one event per TTI
+			enbPhy->AddSoundingUe(ue);
+			return;
+		}
 		enbPhy->ReceiveReferenceSymbols(ue, GetTxSignalForReferenceSymbols());
 		Simulator::Init()->Schedule(0.001, &UeLtePhy::SendReferenceSymbols,
 				this);
 	}
 }
 
+
+UeLtePhy::MimoState* UeLtePhy::GetMimoState(void) {
+	if (m_mimo == nullptr) {
+		m_mimo.reset(new MimoState());
+	}
+	return m_mimo.get();
+}
+
+void UeLtePhy::SetPmiSearch(PmiSearch search) {
+	m_pmiSearch = search;
+}
+
+UeLtePhy::PmiSearch UeLtePhy::GetPmiSearch(void) {
+	return m_pmiSearch;
+}
+
+void UeLtePhy::SetPmiSearchCheck(bool check) {
+	m_pmiSearchCheck = check;
+}
@@ -25,10 +25,13 @@
 #define UE_LTE_PHY_H_
 
 #include "lte-phy.h"
+#include "rx-signal-buffer.h"
 #include <vector>
 #include <armadillo>
 
 class IdealControlMessage;
+class PdcchMapIdealControlMessage;
+class NbIoTMapIdealControlMessage;
 class UserEquipment;
 
 class UeLtePhy :public LtePhy
@@ -42,6 +45,7 @@ public:
   virtual void StartTx (shared_ptr<PacketBurst> p);
   virtual void StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal);
   virtual void StartRx (shared_ptr<PacketBurst> p, TransmittedSignal* txSignal, NetworkNode* src);	// by zyb
+  virtual bool IsRxNeeded (TransmittedSignal* txSignal, NetworkNode* src);
 
   virtual void CreateCqiFeedbacks (vector<double> sinr);
   UserEquipment* GetDevice(void);
@@ -51,22 +55,63 @@ public:
 
   virtual void SendIdealControlMessage (IdealControlMessage *msg);
   virtual void ReceiveIdealControlMessage (IdealControlMessage *msg);
+  // apply the records of an allocation map addressed to this UE
+  void ReceiveAllocationMap (PdcchMapIdealControlMessage *map, const vector<int>& records);
+  void ReceiveNbIoTAllocationMap (NbIoTMapIdealControlMessage *map, const vector<int>& records);
 
   void SendReferenceSymbols (void);
   void SetTxSignalForReferenceSymbols (void);
   TransmittedSignal* GetTxSignalForReferenceSymbols (void);
 
+  /*
+   * PMI search used for the CSI feedback of TX modes 4 and 9:
+   * every codebook entry, i1 then i2 (8 TX), or the neighbourhood of the
+   * PMI preferred at the previous feedback. With the check enabled, every
+   * sub-band where the search misses the exhaustive choice is traced
+   * (TraceSink::TRACE_PMI_SEARCH).
+   */
+  enum PmiSearch
+    {
+      PMI_SEARCH_EXHAUSTIVE,
+      PMI_SEARCH_GREEDY,
+      PMI_SEARCH_NEIGHBOURHOOD
+    };
+  void SetPmiSearch (PmiSearch search);
+  PmiSearch GetPmiSearch (void);
+  void SetPmiSearchCheck (bool check);
+
 protected:
   vector<double> m_sinrForCQI;
   int m_rankForRiFeedback;
 
 private:
+  // state of the multi-antenna TX modes (3, 4, 9, 11), allocated on
+  // first use: single antenna devices such as NB-IoT UEs never carry it
+  struct MimoState
+  {
+    vector< vector<int> > m_pmiForFeedback;
+    vector< shared_ptr<arma::cx_fmat> > m_fullCsiFeedback;
+    vector< vector<int> > m_previousPmis; // preferred PMI for each number of layers and sub channel
+    vector<int> m_assignedLayers;
+    vector< shared_ptr<arma::cx_fmat> > m_precodingMatricesForRx;
+    vector< shared_ptr<arma::cx_fmat> > m_channelMatricesForSrtaPi;
+    // SINR for each number of layers, PMI and sub channel (TX modes 4/9),
+    // reused between receptions; m_measuredPmis lists the PMIs written
+    // since the last reset, the other entries are -INFINITY
+    vector< vector< vector<double> > > m_measuredSinr;
+    vector< vector<int> > m_measuredPmis;
+    vector< vector<bool> > m_isMeasuredPmi;
+    // layers 0 .. l - 1 of a rank l precoder, for each number of layers
+    vector< vector<int> > m_precoderLayers;
+  };
+  MimoState* GetMimoState (void);
+
   vector<double> m_measuredMBSFNSinr;
-  vector< vector<int> > m_pmiForFeedback;
-  vector< shared_ptr<arma::cx_fmat> > m_fullCsiFeedback;
+  unique_ptr<MimoState> m_mimo;
   int m_harqPidForRx;
   int m_harqPidForTx;
   TransmittedSignal* m_txSignalForReferenceSymbols;
+  RxSignalBuffer m_rxSignal;
 
   vector<int> m_channelsForTx;
   vector<int> m_mcsIndexForTx;
@@ -75,9 +120,8 @@ private:
   vector<int> m_mcsIndexForRx;
   int m_rankForRx;
   vector< vector<int> > m_pmiForRx;
-  vector<int> m_assignedLayers;
-  vector< shared_ptr<arma::cx_fmat> > m_precodingMatricesForRx;
-  vector< shared_ptr<arma::cx_fmat> > m_channelMatricesForSrtaPi;
+  PmiSearch m_pmiSearch;
+  bool m_pmiSearchCheck;
 };
 
 #endif /* UE_LTE_PHY_H_ */
@@ -26,7 +26,11 @@
 #include "../utility/RandomVariable.h"
 #include "../utility/eesm-effective-sinr.h"
 #include "../utility/miesm-effective-sinr.h"
+#include "../utility/miesm-table.h"
+#include "../utility/trace-sink.h"
+#include "../utility/random-stream.h"
 #include "../load-parameters.h"
+#include "bler-table.h"
 
 bool
 WidebandCqiEesmErrorModel::CheckForPhysicalError (vector<int> channels, vector<int> mcs, vector<double> sinr)
@@ -45,7 +49,7 @@ WidebandCqiEesmErrorModel::CheckForPhysicalError (vector<int> channels, vector<i
       new_sinr.push_back (sinr.at (channels.at (i)));
     }
 
-DEBUG_LOG_START_1(LTE_SIM_BLER_DEBUG)
+DEBUG_TRACE_START(DEBUG_BLER)
   cout << "\n--> CheckForPhysicalError \n\t\t Channels: ";
   for (int i = 0; i < (int)channels.size (); i++)
     {
@@ -62,7 +66,7 @@ DEBUG_LOG_START_1(LTE_SIM_BLER_DEBUG)
       cout << new_sinr.at (i) << " ";
     }
   cout << "\n"<< endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
 //for (int i = 0; i < (int)new_sinr.size (); i++)
 //  {
@@ -70,18 +74,31 @@ DEBUG_LOG_END
 //  }
 //cout << "mcs " << mcs.at(0) << endl;
 
-for (int i = 0; i < (int)new_sinr.size (); i++)
-    cout << new_sinr.at (i) << " ";
-
-  double effective_sinr = GetMiesmEffectiveSinr (new_sinr);
-  cout << "effective_sinr " << effective_sinr << endl;
-  double randomNumber = (rand () %100 ) / 100.;
+  double effective_sinr = ComputeMiesmEffectiveSinr (new_sinr);
+  TraceSink* trace = TraceSink::Init ();
+  if (trace->IsEnabled (TraceSink::TRACE_BLER_DECISION))
+    {
+      trace->TraceBlerDecision (new_sinr, effective_sinr);
+    }
+  double randomNumber = RandomStream::Current ()->Uniform ();
   int mcs_ = mcs.at (0);
   //cout << "CheckForPhysicalError: " <<  mcs_ << endl;
   //int mcs_ = 6;
   double bler;
+  BlerTable* blerTable = BlerTable::Init ();
 
-  if (_channel_AWGN_)
+  if (blerTable->IsReady ())
+    {
+      if (_channel_TU_ && !_channel_AWGN_)
+        {
+          bler = blerTable->GetBLER (BlerTable::CHANNEL_TYPE_TU, effective_sinr, mcs_);
+        }
+      else
+        {
+          bler = blerTable->GetBLER (BlerTable::CHANNEL_TYPE_AWGN, effective_sinr, mcs_);
+        }
+    }
+  else if (_channel_AWGN_)
     {
       bler = GetBLER_AWGN (effective_sinr, mcs_);
     }
@@ -94,12 +111,12 @@ for (int i = 0; i < (int)new_sinr.size (); i++)
       bler = GetBLER_AWGN (effective_sinr, mcs_);
     }
 
-DEBUG_LOG_START_1(LTE_SIM_BLER_DEBUG)
+DEBUG_TRACE_START(DEBUG_BLER)
   cout <<"CheckForPhysicalError: , effective SINR:" << effective_sinr
             << ", selected CQI: " << mcs_
             << ", random " << randomNumber
             << ", BLER: " << bler << endl;
-DEBUG_LOG_END
+DEBUG_TRACE_END
 
   if (randomNumber < bler)
     {
@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "worker-pool.h"
+
+WorkerPool::WorkerPool (int nbWorkers)
+{
+  m_job = nullptr;
+  m_jobSize = 0;
+  m_nextIndex = 0;
+  m_busyWorkers = 0;
+  m_generation = 0;
+  m_stop = false;
+
+  // the calling thread is one of the workers
+  for (int i = 1; i < nbWorkers; i++)
+    {
+      m_threads.push_back (std::thread (&WorkerPool::WorkerLoop, this));
+    }
+}
+
+WorkerPool::~WorkerPool ()
+{
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_stop = true;
+    }
+  m_wakeUp.notify_all ();
+  for (auto &t : m_threads)
+    {
+      t.join ();
+    }
+}
+
+int
+WorkerPool::GetNbWorkers (void)
+{
+  return m_threads.size () + 1;
+}
+
+void
+WorkerPool::ParallelFor (int n, const std::function<void (int)>& job)
+{
+  if (n <= 0)
+    {
+      return;
+    }
+  if (m_threads.size () == 0 || n == 1)
+    {
+      for (int i = 0; i < n; i++)
+        {
+          job (i);
+        }
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_job = &job;
+      m_jobSize = n;
+      m_nextIndex = 0;
+      m_busyWorkers = m_threads.size ();
+      m_generation++;
+    }
+  m_wakeUp.notify_all ();
+
+  RunJob ();
+
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_done.wait (lock, [this] { return m_busyWorkers == 0; });
+  m_job = nullptr;
+}
+
+void
+WorkerPool::WorkerLoop (void)
+{
+  unsigned long seenGeneration = 0;
+  while (true)
+    {
+        {
+          std::unique_lock<std::mutex> lock (m_mutex);
+          m_wakeUp.wait (lock, [this, seenGeneration]
+            { return m_stop || m_generation != seenGeneration; });
+          if (m_stop)
+            {
+              return;
+            }
+          seenGeneration = m_generation;
+        }
+
+      RunJob ();
+
+        {
+          std::lock_guard<std::mutex> lock (m_mutex);
+          m_busyWorkers--;
+        }
+      m_done.notify_one ();
+    }
+}
+
+void
+WorkerPool::RunJob (void)
+{
+  int i;
+  while ((i = m_nextIndex.fetch_add (1)) < m_jobSize)
+    {
+      (*m_job) (i);
+    }
+}
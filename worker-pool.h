@@ -0,0 +1,65 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2018 TELEMATICS LAB, Politecnico di Bari
+ *
+ * This file is part of 5G-simulator
+ *
+ * 5G-simulator is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 3 as
+ * published by the Free Software Foundation;
+ *
+ * 5G-simulator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with 5G-simulator; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+/*
+ * A fixed set of worker threads executing index-based parallel loops.
+ * The calling thread takes part in the loop, so a pool created with
+ * n workers runs the job on n threads in total.
+ */
+class WorkerPool
+{
+public:
+  WorkerPool (int nbWorkers);
+  virtual ~WorkerPool ();
+
+  int GetNbWorkers (void);
+
+  // Calls job(i) for every i in [0, n) and returns when all calls are done.
+  // Jobs must only touch state owned by index i.
+  void ParallelFor (int n, const std::function<void (int)>& job);
+
+private:
+  void WorkerLoop (void);
+  void RunJob (void);
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_wakeUp;
+  std::condition_variable m_done;
+
+  const std::function<void (int)>* m_job;
+  int m_jobSize;
+  std::atomic<int> m_nextIndex;
+  int m_busyWorkers;
+  unsigned long m_generation;
+  bool m_stop;
+};
+
+#endif /* WORKER_POOL_H_ */